@@ -0,0 +1,319 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host benchmarks
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// Measures the hot paths of the library on a desktop machine using the in-memory PubSubClient.
+// The topic tree benchmarks run with 10, 100, 1000 and 10000 topics. Absolute numbers do not
+// transfer to microcontrollers, but relative changes and the scaling with the number of topics do.
+
+#include <benchmark/benchmark.h>
+#include <SimpleMQTT.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace {
+
+  // Print that discards its output
+  class NullPrint : public Print {
+  public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t*, size_t size) override { return size; }
+  };
+
+  // Client with a tree of integer topics. Groups have at most ten children so that the depth
+  // of the tree grows with the number of topics.
+  struct TopicTree {
+    NullClient network;
+    SimpleMQTTClient client{ network, "bench", "localhost" };
+    MQTTGroup* values = nullptr;
+    std::vector<MQTTTopic*> leaves;
+    std::vector<std::string> setTopics;
+
+    PubSubClient& broker() {
+      return client;
+    };
+
+    void build(MQTTGroup& group, size_t count) {
+      if (count <= 10) {
+        for (size_t i = 0; i < count; i++)
+          leaves.push_back(&group.add<int>(String("v") + i, 0));
+        return;
+      }
+      size_t perChild = 10;
+      while (perChild * 10 < count)
+        perChild *= 10;
+      for (size_t i = 0; count > 0; i++) {
+        size_t n = (count < perChild ? count : perChild);
+        build(group.add(String("g") + i), n);
+        count -= n;
+      }
+    };
+
+    // Connects and completes the initial subscribe and publish passes.
+    void connect() {
+      for (int i = 0; i < 10; i++)
+        client.handle();
+      for (const std::string& s : broker().subscriptions)
+        if (s.size() > 4 && s.compare(s.size() - 4, 4, "/set") == 0)
+          setTopics.push_back(s);
+      broker().recording = false;
+      broker().clearRecorded();
+    };
+
+    TopicTree(size_t count) {
+      values = &client.add("values");
+      build(*values, count);
+      connect();
+    };
+  };
+
+  // The trees are built once per size; topics cannot be removed from a client.
+  TopicTree& getTree(size_t count) {
+    static std::map<size_t, std::unique_ptr<TopicTree>> trees;
+    std::unique_ptr<TopicTree>& tree = trees[count];
+    if (!tree)
+      tree.reset(new TopicTree(count));
+    return *tree;
+  }
+
+  // Previous 64 bit parser: strtoll() and a String round trip to detect overflow
+  bool legacyParseInt64(const char* s, int64_t* valptr) {
+    if (*s == '\0')
+      return false;
+    char* endptr;
+    int64_t v = strtoll(s, &endptr, 10);
+    if (*endptr != '\0')
+      return false;
+    if (String((long long)v) != s)
+      return false;
+    *valptr = v;
+    return true;
+  }
+
+  // Previous fractional parser: strtod() and a round trip through snprintf() to apply the format
+  bool legacyParseFractional(const char* s, double* valptr, const char* format) {
+    if (*s == '\0')
+      return false;
+    char* endptr;
+    double v = strtod(s, &endptr);
+    if (*endptr != '\0')
+      return false;
+    char buffer[SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER];
+    snprintf(buffer, SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER, format, v);
+    v = strtod(buffer, &endptr);
+    if (*endptr != '\0')
+      return false;
+    *valptr = v;
+    return true;
+  }
+
+  void TopicCounts(benchmark::internal::Benchmark* b) {
+    for (int n : { 10, 100, 1000, 10000 })
+      b->Arg(n);
+  }
+
+}  // namespace
+
+// Dispatch of incoming /set messages to the topics, including topic lookup and payload parsing.
+static void BM_ProcessPayload(benchmark::State& state) {
+  TopicTree& tree = getTree(state.range(0));
+  const char* payloads[] = { "12345", "-678" };
+  size_t i = 0;
+  for (auto _ : state) {
+    tree.broker().deliver(tree.setTopics[i % tree.setTopics.size()].c_str(), payloads[i & 1]);
+    i++;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ProcessPayload)->Apply(TopicCounts);
+
+// Republishing all topics of a group and sending them in the next handle() call.
+static void BM_GroupPublish(benchmark::State& state) {
+  TopicTree& tree = getTree(state.range(0));
+  size_t published = tree.broker().publishCount;
+  for (auto _ : state) {
+    tree.values->republish();
+    tree.client.handle();
+  }
+  state.SetItemsProcessed(tree.broker().publishCount - published);
+}
+BENCHMARK(BM_GroupPublish)->Apply(TopicCounts);
+
+// Full topic names of the leaves of the tree.
+static void BM_GetFullTopic(benchmark::State& state) {
+  TopicTree& tree = getTree(state.range(0));
+  size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(tree.leaves[i++ % tree.leaves.size()]->getFullTopic());
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetFullTopic)->Apply(TopicCounts);
+
+// Parsing of a comma-separated payload into an integer array of the given size.
+static void BM_ArraySetFromPayload(benchmark::State& state) {
+  static std::map<size_t, std::pair<std::vector<int>, MQTTTopic*>> arrays;
+  size_t count = state.range(0);
+  std::pair<std::vector<int>, MQTTTopic*>& array = arrays[count];
+  if (array.second == nullptr) {
+    array.first.resize(count);
+    array.second = &getTree(10).client.add(String("array") + count, array.first.data(), count);
+  }
+  std::string payload;
+  for (size_t i = 0; i < count; i++) {
+    if (i > 0)
+      payload += ',';
+    payload += std::to_string((int)(i * 7919 % 100000) - 50000);
+  }
+  for (auto _ : state)
+    benchmark::DoNotOptimize(array.second->setFromPayload(payload));
+  state.SetItemsProcessed(state.iterations() * count);
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BM_ArraySetFromPayload)->Apply(TopicCounts);
+
+// Formatting of values as payloads without creating Strings.
+static void BM_FormatIntegral(benchmark::State& state) {
+  NullPrint out;
+  int32_t value = -123456789;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(__internal::printValue(out, value, IntegralFormat::DECIMAL));
+    value += 7919;
+  }
+}
+BENCHMARK(BM_FormatIntegral);
+
+// Previous implementation: print(String(value, base))
+static void BM_FormatIntegralString(benchmark::State& state) {
+  NullPrint out;
+  int32_t value = -123456789;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(out.print(String(value, 10)));
+    value += 7919;
+  }
+}
+BENCHMARK(BM_FormatIntegralString);
+
+static void BM_FormatInt64(benchmark::State& state) {
+  NullPrint out;
+  int64_t value = -1234567890123456789;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(__internal::printValue(out, value, IntegralFormat::DECIMAL));
+    value += 7919;
+  }
+}
+BENCHMARK(BM_FormatInt64);
+
+static void BM_FormatInt64String(benchmark::State& state) {
+  NullPrint out;
+  int64_t value = -1234567890123456789;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(out.print(String((long long)value, 10)));
+    value += 7919;
+  }
+}
+BENCHMARK(BM_FormatInt64String);
+
+static void BM_FormatFractional(benchmark::State& state) {
+  NullPrint out;
+  FractionalFormat format("%.3f");
+  double value = -1234.5678;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(__internal::printValue(out, value, format));
+    value += 0.7919;
+  }
+}
+BENCHMARK(BM_FormatFractional);
+
+// Previous implementation: snprintf() with the format string
+static void BM_FormatFractionalSnprintf(benchmark::State& state) {
+  NullPrint out;
+  double value = -1234.5678;
+  char buffer[SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER];
+  for (auto _ : state) {
+    snprintf(buffer, SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER, "%.3f", value);
+    benchmark::DoNotOptimize(out.print(buffer));
+    value += 0.7919;
+  }
+}
+BENCHMARK(BM_FormatFractionalSnprintf);
+
+static void BM_ParseIntegral(benchmark::State& state) {
+  const char* payloads[] = { "-123456789", "42", "2147483647", "-2147483648" };
+  int32_t value;
+  size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(__internal::parseValue(std::string_view(payloads[i++ & 3]), &value, IntegralFormat::DECIMAL));
+}
+BENCHMARK(BM_ParseIntegral);
+
+static void BM_ParseInt64(benchmark::State& state) {
+  const char* payloads[] = { "-1234567890123456789", "42", "9223372036854775807", "-9223372036854775808" };
+  int64_t value;
+  size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(__internal::parseValue(std::string_view(payloads[i++ & 3]), &value, IntegralFormat::DECIMAL));
+}
+BENCHMARK(BM_ParseInt64);
+
+static void BM_ParseInt64Legacy(benchmark::State& state) {
+  const char* payloads[] = { "-1234567890123456789", "42", "9223372036854775807", "-9223372036854775808" };
+  int64_t value;
+  size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(legacyParseInt64(payloads[i++ & 3], &value));
+}
+BENCHMARK(BM_ParseInt64Legacy);
+
+static void BM_ParseFractional(benchmark::State& state) {
+  const char* payloads[] = { "-1234.5678", "0.001", "3.14159", "1e10" };
+  FractionalFormat format("%.3f");
+  double value;
+  size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(__internal::parseValue(std::string_view(payloads[i++ & 3]), &value, format));
+}
+BENCHMARK(BM_ParseFractional);
+
+static void BM_ParseFractionalLegacy(benchmark::State& state) {
+  const char* payloads[] = { "-1234.5678", "0.001", "3.14159", "1e10" };
+  double value;
+  size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(legacyParseFractional(payloads[i++ & 3], &value, "%.3f"));
+}
+BENCHMARK(BM_ParseFractionalLegacy);
+
+static void BM_ParseBool(benchmark::State& state) {
+  const char* payloads[] = { "true", "off", "Yes", "toggle" };
+  bool value = false;
+  size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(__internal::parseValue(std::string_view(payloads[i++ & 3]), &value, BoolFormat::ANY));
+}
+BENCHMARK(BM_ParseBool);
+
+#if SIMPLEMQTT_JSON_BUFFERSIZE > 0
+// Json topic set from a payload and formatted again.
+static void BM_JsonRoundTrip(benchmark::State& state) {
+  TopicTree& tree = getTree(10);
+  static MQTTJsonTopic& json = tree.client.addJsonTopic("json");
+  std::string payload = "{\"name\":\"bench\",\"values\":[";
+  for (int64_t i = 0; i < state.range(0); i++)
+    payload += (i > 0 ? "," : "") + std::to_string(i);
+  payload += "]}";
+  for (auto _ : state) {
+    json.setFromPayload(payload);
+    benchmark::DoNotOptimize(json.getPayload());
+  }
+  state.SetBytesProcessed(state.iterations() * payload.size());
+}
+// the document must fit into SIMPLEMQTT_JSON_BUFFERSIZE
+BENCHMARK(BM_JsonRoundTrip)->Arg(10)->Arg(100);
+#endif
+
+BENCHMARK_MAIN();
@@ -0,0 +1,342 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT end-to-end load test against the loopback broker
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// Connects a SimpleMQTTClient with N settable topics to the loopback broker through a TCP socket
+// and drives it from a second connection:
+//   sync       initial connect, subscribe and publish of all topics
+//   set        M /set messages per second for the given duration, each with a unique value
+//   get        /get storms on the group that holds all topics
+//   reconnect  connection drops by the broker, each followed by the resynchronization of all topics
+//              (the client uses full resync so that the end of the resynchronization can be observed)
+// Reports messages per second, the latency from sending a /set message to receiving the
+// republished value, bytes on the wire and the time spent in handle().
+//
+// Usage: simplemqtt_loadtest [--topics=N] [--rate=M] [--duration=seconds] [--get-storms=K]
+//                            [--reconnects=R] [--budget=microseconds]
+
+#include "LoopbackBroker.h"
+#include "PosixClient.h"
+#include <SimpleMQTT.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace {
+
+  struct Options {
+    uint32_t topics = 100;
+    uint32_t rate = 1000;
+    double duration = 2;
+    uint32_t getStorms = 10;
+    uint32_t reconnects = 5;
+    uint32_t budget = 0;
+  };
+
+  enum Phase { SYNC, SET, GET, RECONNECT, DONE };
+  const char* PHASE_NAMES[] = { "sync", "set", "get", "reconnect" };
+
+  uint64_t now() {
+    return SimpleMQTTHost::clockMicros();
+  }
+
+  // Time spent in handle() per phase
+  struct HandleStatistics {
+    uint64_t calls = 0;
+    uint64_t total = 0;
+    uint64_t max = 0;
+  };
+
+  // Results of a phase as measured by the driver
+  struct PhaseResult {
+    uint64_t duration = 0;  // microseconds
+    uint64_t messages = 0;  // value messages received by the driver
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+    std::vector<uint64_t> times;  // latencies or durations of the repetitions in microseconds
+    bool complete = true;
+  };
+
+  // Second MQTT connection that generates the load and observes the published values.
+  class Driver {
+    PosixClient network;
+    PubSubClient mqtt{ network };
+    const Options& options;
+    LoopbackBroker& broker;
+    PosixClient& clientNetwork;
+    const std::vector<std::string>& setTopics;
+    std::string getTopic;
+    std::string valuePrefix;
+    bool ready = false;
+
+    // send time of each /set value, indexed by the value
+    std::vector<uint64_t> sendTimes;
+    std::vector<bool> answered;
+    uint64_t valueMessages = 0;
+    std::vector<uint64_t>* latencies = nullptr;
+
+    void received(const char* topic, const uint8_t* payload, unsigned int length) {
+      std::string_view t(topic);
+      if (t == "loadtest/ready") {
+        ready = true;
+        return;
+      }
+      if (t.substr(0, valuePrefix.size()) != valuePrefix || t.size() < 4)
+        return;
+      std::string_view suffix = t.substr(t.size() - 4);
+      if (suffix == "/set" || suffix == "/get")
+        return;
+      valueMessages++;
+      if (latencies == nullptr)
+        return;
+      std::string p((const char*)payload, length);
+      long value = atol(p.c_str());
+      if (value > 0 && (size_t)value < sendTimes.size() && sendTimes[value] != 0 && !answered[value]) {
+        answered[value] = true;
+        latencies->push_back(now() - sendTimes[value]);
+      }
+    };
+
+    // Processes incoming messages, waiting up to the given time for the first one.
+    void pump(int timeoutMs) {
+      if (!network.waitAvailable(timeoutMs))
+        return;
+      while (network.available() > 0)
+        mqtt.loop();
+    };
+
+    // Waits until the given number of value messages has arrived.
+    bool waitForValues(uint64_t count, uint64_t timeout) {
+      uint64_t start = now();
+      while (valueMessages < count) {
+        if (now() - start > timeout)
+          return false;
+        pump(10);
+      }
+      return true;
+    };
+
+    void begin(PhaseResult& result) {
+      result.bytesSent = clientNetwork.bytesSent;
+      result.bytesReceived = clientNetwork.bytesReceived;
+      result.duration = now();
+      result.messages = valueMessages;
+    };
+
+    void end(PhaseResult& result) {
+      result.bytesSent = clientNetwork.bytesSent - result.bytesSent;
+      result.bytesReceived = clientNetwork.bytesReceived - result.bytesReceived;
+      result.duration = now() - result.duration;
+      result.messages = valueMessages - result.messages;
+    };
+
+  public:
+    Driver(const Options& anOptions, LoopbackBroker& aBroker, PosixClient& aClientNetwork, const std::vector<std::string>& aSetTopics, const std::string& aGetTopic)
+      : options(anOptions), broker(aBroker), clientNetwork(aClientNetwork), setTopics(aSetTopics), getTopic(aGetTopic) {
+      valuePrefix = "loadtest/values/";
+    };
+
+    // Connects and subscribes to the values. Returns when the subscriptions are active.
+    bool connect() {
+      mqtt.setServer("127.0.0.1", broker.port());
+      mqtt.setCallback([this](char* topic, uint8_t* payload, unsigned int length) { received(topic, payload, length); });
+      if (!mqtt.connect("loadtest-driver"))
+        return false;
+      mqtt.subscribe((valuePrefix + "#").c_str());
+      mqtt.subscribe("loadtest/ready");
+      mqtt.publish("loadtest/ready", "");
+      uint64_t start = now();
+      while (!ready && now() - start < 5000000)
+        pump(10);
+      return ready;
+    };
+
+    void run(std::atomic<int>& phase, PhaseResult* results) {
+      size_t n = setTopics.size();
+
+      // initial synchronization
+      begin(results[SYNC]);
+      results[SYNC].complete = waitForValues(n, 30000000);
+      end(results[SYNC]);
+
+      // set traffic
+      phase = SET;
+      PhaseResult& set = results[SET];
+      uint64_t count = (uint64_t)(options.rate * options.duration);
+      sendTimes.assign(count + 1, 0);
+      answered.assign(count + 1, false);
+      latencies = &set.times;
+      begin(set);
+      uint64_t start = now();
+      uint64_t interval = 1000000 / (options.rate > 0 ? options.rate : 1);
+      for (uint64_t value = 1; value <= count; value++) {
+        uint64_t due = start + (value - 1) * interval;
+        for (uint64_t t = now(); t < due; t = now())
+          pump((int)((due - t) / 1000));
+        sendTimes[value] = now();
+        mqtt.publish(setTopics[value % n].c_str(), String((unsigned long)value).c_str());
+      }
+      // wait for the last republishes
+      uint64_t sent = now();
+      while (set.times.size() < count && now() - sent < 2000000)
+        pump(10);
+      latencies = nullptr;
+      end(set);
+
+      // /get storms
+      phase = GET;
+      PhaseResult& get = results[GET];
+      begin(get);
+      for (uint32_t i = 0; i < options.getStorms; i++) {
+        uint64_t t = now();
+        mqtt.publish(getTopic.c_str(), "");
+        if (!waitForValues(valueMessages + n, 10000000)) {
+          get.complete = false;
+          break;
+        }
+        get.times.push_back(now() - t);
+      }
+      end(get);
+
+      // reconnect flood
+      phase = RECONNECT;
+      PhaseResult& reconnect = results[RECONNECT];
+      begin(reconnect);
+      for (uint32_t i = 0; i < options.reconnects; i++) {
+        uint64_t t = now();
+        broker.drop("loadtest");
+        if (!waitForValues(valueMessages + n, 10000000)) {
+          reconnect.complete = false;
+          break;
+        }
+        reconnect.times.push_back(now() - t);
+      }
+      end(reconnect);
+
+      mqtt.disconnect();
+      phase = DONE;
+    };
+  };
+
+  uint64_t percentile(std::vector<uint64_t>& values, double p) {
+    if (values.empty())
+      return 0;
+    std::sort(values.begin(), values.end());
+    size_t i = (size_t)(values.size() * p);
+    return values[i < values.size() ? i : values.size() - 1];
+  }
+
+  bool parseOption(const char* arg, const char* name, double* value) {
+    size_t length = strlen(name);
+    if (strncmp(arg, name, length) != 0 || arg[length] != '=')
+      return false;
+    *value = atof(arg + length + 1);
+    return true;
+  }
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    double v;
+    if (parseOption(argv[i], "--topics", &v))
+      options.topics = (uint32_t)v;
+    else if (parseOption(argv[i], "--rate", &v))
+      options.rate = (uint32_t)v;
+    else if (parseOption(argv[i], "--duration", &v))
+      options.duration = v;
+    else if (parseOption(argv[i], "--get-storms", &v))
+      options.getStorms = (uint32_t)v;
+    else if (parseOption(argv[i], "--reconnects", &v))
+      options.reconnects = (uint32_t)v;
+    else if (parseOption(argv[i], "--budget", &v))
+      options.budget = (uint32_t)v;
+    else {
+      printf("Usage: %s [--topics=N] [--rate=M] [--duration=seconds] [--get-storms=K] [--reconnects=R] [--budget=microseconds]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (options.topics == 0) {
+    printf("At least one topic is required\n");
+    return 2;
+  }
+
+  LoopbackBroker broker;
+  if (!broker.start()) {
+    printf("Unable to start the broker\n");
+    return 1;
+  }
+
+  // client under test: the topics are distributed over groups of up to 100 topics
+  PosixClient network;
+  SimpleMQTTClient client(network, "loadtest", "127.0.0.1", broker.port());
+  client.setHandleBudget(options.budget);
+  client.setFullResync(true);
+  MQTTGroup& values = client.add("values");
+  std::vector<std::string> setTopics;
+  MQTTGroup* group = nullptr;
+  for (uint32_t i = 0; i < options.topics; i++) {
+    if (i % 100 == 0)
+      group = &values.add(String("g") + (i / 100));
+    MQTTTopic& topic = group->add<int32_t>(String("v") + (i % 100), 0);
+    setTopics.push_back(client.getFinalTopic(topic.getSetTopic()).c_str());
+  }
+  std::string getTopic = client.getFinalTopic(values.getRequestTopic()).c_str();
+
+  Driver driver(options, broker, network, setTopics, getTopic);
+  if (!driver.connect()) {
+    printf("Unable to connect the driver\n");
+    return 1;
+  }
+
+  std::atomic<int> phase{ SYNC };
+  PhaseResult results[DONE];
+  HandleStatistics handleStatistics[DONE];
+  std::thread driverThread([&]() { driver.run(phase, results); });
+  int current;
+  while ((current = phase) != DONE) {
+    uint64_t start = now();
+    client.handle();
+    uint64_t duration = now() - start;
+    HandleStatistics& h = handleStatistics[current];
+    h.calls++;
+    h.total += duration;
+    if (duration > h.max)
+      h.max = duration;
+    // sleep only if there is nothing to do
+    if (network.available() == 0 && client.getLag() == 0)
+      network.waitAvailable(1);
+  }
+  driverThread.join();
+  broker.stop();
+
+  printf("topics: %u, set rate: %u/s, duration: %.1f s, handle budget: %u us\n\n", options.topics, options.rate, options.duration, options.budget);
+  printf("%-10s %10s %10s %12s %10s %10s %10s %12s %12s %10s %10s\n", "phase", "time ms", "messages", "messages/s", "p50 us", "p99 us", "max us",
+         "bytes sent", "bytes recv", "handles", "avg us");
+  bool ok = true;
+  for (int p = SYNC; p < DONE; p++) {
+    PhaseResult& r = results[p];
+    HandleStatistics& h = handleStatistics[p];
+    double seconds = r.duration / 1e6;
+    uint64_t max = (r.times.empty() ? 0 : *std::max_element(r.times.begin(), r.times.end()));
+    printf("%-10s %10.1f %10llu %12.0f %10llu %10llu %10llu %12llu %12llu %10llu %10.1f%s\n", PHASE_NAMES[p], r.duration / 1e3, (unsigned long long)r.messages,
+           seconds > 0 ? r.messages / seconds : 0.0, (unsigned long long)percentile(r.times, 0.5), (unsigned long long)percentile(r.times, 0.99),
+           (unsigned long long)max, (unsigned long long)r.bytesSent, (unsigned long long)r.bytesReceived, (unsigned long long)h.calls,
+           h.calls > 0 ? (double)h.total / h.calls : 0.0, r.complete ? "" : "  INCOMPLETE");
+    ok = ok && r.complete;
+  }
+  uint64_t expected = (uint64_t)(options.rate * options.duration);
+  printf("\nset: %zu of %llu values republished (others were overwritten before they were published)\n", results[SET].times.size(), (unsigned long long)expected);
+  printf("p50/p99: set-to-republish latency for set, duration of a storm or reconnect for get and reconnect\n");
+  LoopbackBroker::Statistics s = broker.statistics();
+  printf("broker: %llu connects, %llu publishes in, %llu publishes out, %llu bytes in, %llu bytes out\n", (unsigned long long)s.connects,
+         (unsigned long long)s.publishesIn, (unsigned long long)s.publishesOut, (unsigned long long)s.bytesIn, (unsigned long long)s.bytesOut);
+  if (expected > 0 && results[SET].times.empty())
+    ok = false;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,451 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host build: minimal MQTT 3.1.1 broker on localhost
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// In-process broker for end-to-end tests. Listens on 127.0.0.1 and serves its connections from
+// a background thread. Supports what SimpleMQTT and PubSubClient use: CONNECT with will and
+// credentials, SUBSCRIBE/UNSUBSCRIBE with + and # wildcards, PUBLISH with QoS 0 and 1 (delivered
+// with QoS 0), retained messages, PINGREQ and DISCONNECT. Sessions are not persisted.
+
+#pragma once
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+class LoopbackBroker {
+public:
+  struct Statistics {
+    uint64_t connects = 0;
+    uint64_t packetsIn = 0;
+    uint64_t packetsOut = 0;
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t publishesIn = 0;
+    uint64_t publishesOut = 0;
+  };
+
+protected:
+  struct Connection {
+    int fd = -1;
+    std::string in;
+    std::string out;
+    std::string clientId;
+    bool connected = false;
+    bool closing = false;
+    std::vector<std::string> filters;
+    bool hasWill = false;
+    std::string willTopic;
+    std::string willMessage;
+    bool willRetain = false;
+  };
+
+  int listenFd = -1;
+  int wakePipe[2] = { -1, -1 };
+  uint16_t listenPort = 0;
+  std::thread thread;
+  std::mutex mutex;  // protects everything below
+  bool running = false;
+  std::vector<std::unique_ptr<Connection>> connections;
+  std::map<std::string, std::string> retained;
+  std::vector<std::string> dropRequests;
+  Statistics stats;
+
+  static void putLength(std::string& s, size_t length) {
+    do {
+      uint8_t digit = length & 127;
+      length >>= 7;
+      if (length > 0)
+        digit |= 0x80;
+      s += (char)digit;
+    } while (length > 0);
+  };
+
+  static void putString(std::string& s, std::string_view str) {
+    s += (char)(str.size() >> 8);
+    s += (char)(str.size() & 0xFF);
+    s += str;
+  };
+
+  static bool getString(std::string_view& data, std::string_view* str) {
+    if (data.size() < 2)
+      return false;
+    size_t length = ((uint8_t)data[0] << 8) | (uint8_t)data[1];
+    if (data.size() < 2 + length)
+      return false;
+    *str = data.substr(2, length);
+    data.remove_prefix(2 + length);
+    return true;
+  };
+
+  void send(Connection& c, uint8_t header, std::string_view body) {
+    c.out += (char)header;
+    putLength(c.out, body.size());
+    c.out += body;
+    stats.packetsOut++;
+  };
+
+  void deliver(Connection& c, std::string_view topic, std::string_view payload, bool retain) {
+    std::string body;
+    putString(body, topic);
+    body += payload;
+    send(c, 0x30 | (retain ? 1 : 0), body);
+    stats.publishesOut++;
+  };
+
+  void route(std::string_view topic, std::string_view payload, bool retain) {
+    if (retain) {
+      if (payload.empty())
+        retained.erase(std::string(topic));
+      else
+        retained[std::string(topic)] = std::string(payload);
+    }
+    for (auto& c : connections) {
+      if (!c->connected || c->closing)
+        continue;
+      for (const std::string& filter : c->filters) {
+        if (matches(filter, topic)) {
+          deliver(*c, topic, payload, false);
+          break;
+        }
+      }
+    }
+  };
+
+  // Closes a connection. An unexpected close publishes the will.
+  void close(Connection& c, bool publishWill) {
+    if (c.closing)
+      return;
+    c.closing = true;
+    if (publishWill && c.connected && c.hasWill)
+      route(c.willTopic, c.willMessage, c.willRetain);
+    c.connected = false;
+  };
+
+  void handlePacket(Connection& c, uint8_t header, std::string_view data) {
+    stats.packetsIn++;
+    uint8_t type = header >> 4;
+    if (!c.connected && type != 1) {
+      close(c, false);
+      return;
+    }
+    switch (type) {
+      case 1: {  // CONNECT
+        std::string_view protocol, id, value;
+        if (!getString(data, &protocol) || protocol != "MQTT" || data.size() < 4) {
+          close(c, false);
+          return;
+        }
+        uint8_t flags = data[1];
+        data.remove_prefix(4);
+        if (!getString(data, &id)) {
+          close(c, false);
+          return;
+        }
+        c.clientId = std::string(id);
+        if (flags & 0x04) {
+          c.hasWill = true;
+          c.willRetain = (flags & 0x20) != 0;
+          if (!getString(data, &value))
+            return close(c, false);
+          c.willTopic = std::string(value);
+          if (!getString(data, &value))
+            return close(c, false);
+          c.willMessage = std::string(value);
+        }
+        // a new connection with the same client id takes over the session
+        for (auto& other : connections)
+          if (other.get() != &c && other->connected && other->clientId == c.clientId)
+            close(*other, false);
+        c.connected = true;
+        stats.connects++;
+        send(c, 0x20, std::string("\x00\x00", 2));
+        break;
+      }
+      case 3: {  // PUBLISH
+        uint8_t qos = (header >> 1) & 3;
+        std::string_view topic;
+        if (!getString(data, &topic)) {
+          close(c, true);
+          return;
+        }
+        if (qos > 0) {
+          if (data.size() < 2) {
+            close(c, true);
+            return;
+          }
+          send(c, 0x40, data.substr(0, 2));
+          data.remove_prefix(2);
+        }
+        stats.publishesIn++;
+        route(topic, data, (header & 1) != 0);
+        break;
+      }
+      case 8: {  // SUBSCRIBE
+        if (data.size() < 2)
+          return close(c, true);
+        std::string ack(data.substr(0, 2));
+        data.remove_prefix(2);
+        std::vector<std::string> added;
+        std::string_view filter;
+        while (getString(data, &filter) && !data.empty()) {
+          data.remove_prefix(1);
+          c.filters.emplace_back(filter);
+          added.emplace_back(filter);
+          ack += '\0';
+        }
+        send(c, 0x90, ack);
+        for (const std::string& f : added)
+          for (auto& r : retained)
+            if (matches(f, r.first))
+              deliver(c, r.first, r.second, true);
+        break;
+      }
+      case 10: {  // UNSUBSCRIBE
+        if (data.size() < 2)
+          return close(c, true);
+        std::string ack(data.substr(0, 2));
+        data.remove_prefix(2);
+        std::string_view filter;
+        while (getString(data, &filter))
+          for (size_t i = 0; i < c.filters.size(); i++)
+            if (c.filters[i] == filter)
+              c.filters.erase(c.filters.begin() + i--);
+        send(c, 0xB0, ack);
+        break;
+      }
+      case 12:  // PINGREQ
+        send(c, 0xD0, std::string_view());
+        break;
+      case 14:  // DISCONNECT
+        close(c, false);
+        break;
+      default:
+        break;
+    }
+  };
+
+  // Extracts the complete packets from the input buffer.
+  void process(Connection& c) {
+    size_t pos = 0;
+    while (!c.closing && c.in.size() - pos >= 2) {
+      size_t length = 0;
+      size_t multiplier = 1;
+      size_t i = pos + 1;
+      bool complete = false;
+      for (; i < c.in.size() && i < pos + 5; i++) {
+        uint8_t digit = c.in[i];
+        length += (digit & 127) * multiplier;
+        multiplier <<= 7;
+        if ((digit & 128) == 0) {
+          complete = true;
+          break;
+        }
+      }
+      if (!complete) {
+        if (i >= pos + 5)
+          close(c, true);
+        break;
+      }
+      size_t start = i + 1;
+      if (c.in.size() - start < length)
+        break;
+      handlePacket(c, c.in[pos], std::string_view(c.in).substr(start, length));
+      pos = start + length;
+    }
+    c.in.erase(0, pos);
+  };
+
+  void flush(Connection& c) {
+    while (!c.out.empty()) {
+      ssize_t n = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+      if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+          c.out.clear();
+          close(c, true);
+        }
+        return;
+      }
+      stats.bytesOut += n;
+      c.out.erase(0, n);
+    }
+  };
+
+  void run() {
+    std::vector<pollfd> fds;
+    char buffer[4096];
+    while (true) {
+      fds.clear();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running)
+          break;
+        fds.push_back({ listenFd, POLLIN, 0 });
+        fds.push_back({ wakePipe[0], POLLIN, 0 });
+        for (auto& c : connections)
+          fds.push_back({ c->fd, (short)(POLLIN | (c->out.empty() ? 0 : POLLOUT)), 0 });
+      }
+      if (poll(fds.data(), fds.size(), 100) < 0 && errno != EINTR)
+        break;
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (fds[1].revents & POLLIN)
+        while (read(wakePipe[0], buffer, sizeof(buffer)) > 0) {}
+      if (fds[0].revents & POLLIN) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd >= 0) {
+          int one = 1;
+          setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+          fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+          connections.emplace_back(new Connection());
+          connections.back()->fd = fd;
+        }
+      }
+      for (size_t i = 2; i < fds.size(); i++) {
+        Connection& c = *connections[i - 2];
+        if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) == 0)
+          continue;
+        ssize_t n = recv(c.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (n > 0) {
+          stats.bytesIn += n;
+          c.in.append(buffer, n);
+          process(c);
+        } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+          close(c, true);
+      }
+      for (const std::string& id : dropRequests)
+        for (auto& c : connections)
+          if (c->connected && (id.empty() || c->clientId == id))
+            close(*c, true);
+      dropRequests.clear();
+      for (auto& c : connections)
+        flush(*c);
+      for (size_t i = 0; i < connections.size(); i++) {
+        if (connections[i]->closing) {
+          ::close(connections[i]->fd);
+          connections.erase(connections.begin() + i--);
+        }
+      }
+    }
+  };
+
+  void wake() {
+    char c = 0;
+    if (write(wakePipe[1], &c, 1) < 0) {}
+  };
+
+public:
+  ~LoopbackBroker() {
+    stop();
+  };
+
+  // Returns whether a topic matches a subscription filter with + and # wildcards.
+  static bool matches(std::string_view filter, std::string_view topic) {
+    // topics starting with $ are not matched by wildcards at the first level
+    if (!topic.empty() && topic[0] == '$' && !filter.empty() && (filter[0] == '+' || filter[0] == '#'))
+      return false;
+    while (true) {
+      size_t f = filter.find('/');
+      size_t t = topic.find('/');
+      std::string_view fLevel = filter.substr(0, f);
+      std::string_view tLevel = topic.substr(0, t);
+      if (fLevel == "#")
+        return true;
+      if (fLevel != "+" && fLevel != tLevel)
+        return false;
+      if (f == std::string_view::npos || t == std::string_view::npos)
+        // "a/#" also matches "a"
+        return f == t || (t == std::string_view::npos && filter.substr(f + 1) == "#");
+      filter.remove_prefix(f + 1);
+      topic.remove_prefix(t + 1);
+    }
+  };
+
+  // Starts listening on the given port of 127.0.0.1 (0 selects a free port).
+  bool start(uint16_t port = 0) {
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0)
+      return false;
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    socklen_t length = sizeof(address);
+    if (bind(listenFd, (sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd, 16) != 0
+        || getsockname(listenFd, (sockaddr*)&address, &length) != 0 || pipe(wakePipe) != 0) {
+      ::close(listenFd);
+      listenFd = -1;
+      return false;
+    }
+    fcntl(wakePipe[0], F_SETFL, fcntl(wakePipe[0], F_GETFL) | O_NONBLOCK);
+    listenPort = ntohs(address.sin_port);
+    running = true;
+    thread = std::thread(&LoopbackBroker::run, this);
+    return true;
+  };
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!running)
+        return;
+      running = false;
+    }
+    wake();
+    thread.join();
+    for (auto& c : connections)
+      ::close(c->fd);
+    connections.clear();
+    ::close(listenFd);
+    ::close(wakePipe[0]);
+    ::close(wakePipe[1]);
+    listenFd = -1;
+  };
+
+  uint16_t port() const {
+    return listenPort;
+  };
+
+  // Closes the connections of the given client (all clients if empty) as if the network had failed.
+  void drop(const std::string& clientId = std::string()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      dropRequests.push_back(clientId);
+    }
+    wake();
+  };
+
+  // Returns the number of clients that are currently connected.
+  size_t clientCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t n = 0;
+    for (auto& c : connections)
+      if (c->connected)
+        n++;
+    return n;
+  };
+
+  Statistics statistics() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+  };
+};
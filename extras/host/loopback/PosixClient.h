@@ -0,0 +1,159 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host build: Arduino Client on top of POSIX sockets
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Client.h"
+
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// TCP client with non-blocking reads like the WiFiClient of the microcontrollers.
+// Counts the bytes sent and received over all connections.
+class PosixClient : public Client {
+  int fd = -1;
+  uint8_t rxBuffer[4096];
+  size_t rxStart = 0;
+  size_t rxEnd = 0;
+  bool peerClosed = false;
+
+  // Reads what is available from the socket if the receive buffer is empty.
+  void fill() {
+    if (fd < 0 || rxStart < rxEnd || peerClosed)
+      return;
+    rxStart = rxEnd = 0;
+    ssize_t n = recv(fd, rxBuffer, sizeof(rxBuffer), MSG_DONTWAIT);
+    if (n > 0) {
+      rxEnd = n;
+      bytesReceived += n;
+    } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+      peerClosed = true;
+  };
+
+public:
+  std::atomic<uint64_t> bytesSent{ 0 };
+  std::atomic<uint64_t> bytesReceived{ 0 };
+  uint32_t connects = 0;
+
+  ~PosixClient() {
+    stop();
+  };
+
+  int connect(IPAddress ip, uint16_t port) override {
+    return connect(ip.toString().c_str(), port);
+  };
+
+  int connect(const char* host, uint16_t port) override {
+    stop();
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses;
+    if (getaddrinfo(host, std::to_string(port).c_str(), &hints, &addresses) != 0)
+      return 0;
+    for (addrinfo* a = addresses; a != nullptr && fd < 0; a = a->ai_next) {
+      fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+      if (fd < 0)
+        continue;
+      if (::connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+      }
+    }
+    freeaddrinfo(addresses);
+    if (fd < 0)
+      return 0;
+    // MQTT packets are small; send them without delay
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    connects++;
+    return 1;
+  };
+
+  size_t write(uint8_t b) override {
+    return write(&b, 1);
+  };
+
+  size_t write(const uint8_t* buffer, size_t size) override {
+    size_t sent = 0;
+    while (fd >= 0 && sent < size) {
+      ssize_t n = send(fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        peerClosed = true;
+        break;
+      }
+      sent += n;
+    }
+    bytesSent += sent;
+    return sent;
+  };
+
+  int available() override {
+    fill();
+    return rxEnd - rxStart;
+  };
+
+  int read() override {
+    if (available() == 0)
+      return -1;
+    return rxBuffer[rxStart++];
+  };
+
+  int read(uint8_t* buffer, size_t size) override {
+    size_t n = available();
+    if (n == 0)
+      return -1;
+    if (n > size)
+      n = size;
+    memcpy(buffer, rxBuffer + rxStart, n);
+    rxStart += n;
+    return n;
+  };
+
+  int peek() override {
+    if (available() == 0)
+      return -1;
+    return rxBuffer[rxStart];
+  };
+
+  void flush() override {};
+
+  void stop() override {
+    if (fd >= 0)
+      close(fd);
+    fd = -1;
+    rxStart = rxEnd = 0;
+    peerClosed = false;
+  };
+
+  uint8_t connected() override {
+    return fd >= 0 && (!peerClosed || available() > 0);
+  };
+
+  operator bool() override {
+    return fd >= 0;
+  };
+
+  // Waits up to the given time for incoming data. Returns whether data is available.
+  bool waitAvailable(int timeoutMs) {
+    if (available() > 0)
+      return true;
+    if (fd < 0 || peerClosed)
+      return false;
+    pollfd p = { fd, POLLIN, 0 };
+    return poll(&p, 1, timeoutMs) > 0;
+  };
+};
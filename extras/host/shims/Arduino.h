@@ -0,0 +1,322 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host build: minimal Arduino core stand-in
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// Provides just enough of the Arduino core (String, Print, Stream, PROGMEM, millis()) to compile
+// the library on a desktop machine. Each host executable must include SimpleMQTT.h from exactly one
+// translation unit because the library is header-only.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdarg>
+#include <cctype>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <chrono>
+#include <thread>
+
+using std::ptrdiff_t;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// PROGMEM is ordinary memory on the host
+#define PROGMEM
+#define PSTR(s) (s)
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(PSTR(s)))
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper*>(p))
+
+inline char* strncpy_P(char* dest, const char* src, size_t n) { return strncpy(dest, src, n); }
+inline int strcmp_P(const char* a, const char* b) { return strcmp(a, b); }
+inline size_t strlen_P(const char* s) { return strlen(s); }
+inline int memcmp_P(const void* a, const void* b, size_t n) { return memcmp(a, b, n); }
+inline void* memcpy_P(void* dest, const void* src, size_t n) { return memcpy(dest, src, n); }
+inline uint8_t pgm_read_byte(const void* p) { return *(const uint8_t*)p; }
+
+namespace SimpleMQTTHost {
+
+  // The clock runs in real time unless it is switched to manual mode, in which it only advances
+  // when advanceMillis() is called. Values wrap at 32 bits like on the microcontrollers.
+  inline bool manualClock = false;
+  inline uint64_t manualMicros = 0;
+  inline const std::chrono::steady_clock::time_point clockStart = std::chrono::steady_clock::now();
+
+  inline void setManualClock(bool manual) {
+    manualClock = manual;
+  }
+
+  inline void advanceMillis(uint32_t ms) {
+    manualMicros += (uint64_t)ms * 1000;
+  }
+
+  inline uint64_t clockMicros() {
+    if (manualClock)
+      return manualMicros;
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - clockStart).count();
+  }
+
+}  // namespace SimpleMQTTHost
+
+inline unsigned long micros() { return (uint32_t)SimpleMQTTHost::clockMicros(); }
+inline unsigned long millis() { return (uint32_t)(SimpleMQTTHost::clockMicros() / 1000); }
+inline void delay(unsigned long) {}
+inline void yield() { std::this_thread::yield(); }
+inline long random(long max) { return max > 0 ? rand() % max : 0; }
+inline long random(long min, long max) { return max > min ? min + rand() % (max - min) : min; }
+
+// Formats a floating point value like the AVR libc function.
+inline char* dtostrf(double value, signed char width, unsigned char precision, char* buffer) {
+  if (std::isnan(value))
+    sprintf(buffer, "%*s", width, "nan");
+  else if (std::isinf(value))
+    sprintf(buffer, "%*s", width, value < 0 ? "-inf" : "inf");
+  else
+    sprintf(buffer, "%*.*f", width, precision, value);
+  return buffer;
+}
+
+// Arduino String backed by a std::string.
+class String {
+  std::string s;
+
+  void formatUnsigned(unsigned long long value, unsigned char base) {
+    char buffer[8 * sizeof(value) + 1];
+    char* p = &buffer[sizeof(buffer) - 1];
+    *p = '\0';
+    do {
+      *--p = "0123456789abcdefghijklmnopqrstuvwxyz"[value % base];
+      value /= base;
+    } while (value > 0);
+    s = p;
+  };
+
+  void formatSigned(long long value, unsigned char base) {
+    if (value < 0 && base == 10) {
+      formatUnsigned(-(unsigned long long)value, base);
+      s.insert(s.begin(), '-');
+    } else
+      formatUnsigned((unsigned long long)value, base);
+  };
+
+  void formatFloat(double value, unsigned char decimals) {
+    char buffer[330];
+    s = dtostrf(value, decimals + 2, decimals, buffer);
+  };
+
+public:
+  String() {}
+  String(const char* c) : s(c != nullptr ? c : "") {}
+  String(const char* c, unsigned int length) : s(c, length) {}
+  String(const String&) = default;
+  String(String&&) = default;
+  explicit String(char c) : s(1, c) {}
+  explicit String(const __FlashStringHelper* f) : s((const char*)f) {}
+  explicit String(unsigned char value, unsigned char base = 10) { formatUnsigned(value, base); }
+  explicit String(int value, unsigned char base = 10) { formatSigned(value, base); }
+  explicit String(unsigned int value, unsigned char base = 10) { formatUnsigned(value, base); }
+  explicit String(long value, unsigned char base = 10) { formatSigned(value, base); }
+  explicit String(unsigned long value, unsigned char base = 10) { formatUnsigned(value, base); }
+  explicit String(long long value, unsigned char base = 10) { formatSigned(value, base); }
+  explicit String(unsigned long long value, unsigned char base = 10) { formatUnsigned(value, base); }
+  explicit String(short value, unsigned char base = 10) { formatSigned(value, base); }
+  explicit String(unsigned short value, unsigned char base = 10) { formatUnsigned(value, base); }
+  explicit String(signed char value, unsigned char base = 10) { formatSigned(value, base); }
+  explicit String(bool value) { formatUnsigned(value, 10); }
+  explicit String(float value, unsigned char decimals = 2) { formatFloat(value, decimals); }
+  explicit String(double value, unsigned char decimals = 2) { formatFloat(value, decimals); }
+
+  String& operator=(const String&) = default;
+  String& operator=(String&&) = default;
+  String& operator=(const char* c) { s = (c != nullptr ? c : ""); return *this; }
+
+  const char* c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.size(); }
+  bool reserve(unsigned int size) { s.reserve(size); return true; }
+  bool isEmpty() const { return s.empty(); }
+  void clear() { s.clear(); }
+
+  char operator[](unsigned int i) const { return i < s.size() ? s[i] : '\0'; }
+  char& operator[](unsigned int i) { return s[i]; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+  void setCharAt(unsigned int i, char c) { if (i < s.size()) s[i] = c; }
+
+  bool concat(const String& other) { s += other.s; return true; }
+  bool concat(const char* c) { if (c != nullptr) s += c; return true; }
+  bool concat(const char* c, unsigned int length) { s.append(c, length); return true; }
+  bool concat(char c) { s += c; return true; }
+  bool concat(const __FlashStringHelper* f) { s += (const char*)f; return true; }
+  bool concat(bool b) { s += (b ? '1' : '0'); return true; }
+  template<typename N, typename std::enable_if<std::is_arithmetic_v<N> && !std::is_same_v<N, char> && !std::is_same_v<N, bool>, int>::type = 0>
+  bool concat(N n) { s += String(n).s; return true; }
+  template<typename T>
+  String& operator+=(const T& value) { concat(value); return *this; }
+
+  bool operator==(const String& other) const { return s == other.s; }
+  bool operator==(const char* c) const { return s == (c != nullptr ? c : ""); }
+  bool operator!=(const String& other) const { return s != other.s; }
+  bool operator!=(const char* c) const { return !(*this == c); }
+  bool operator<(const String& other) const { return s < other.s; }
+  bool equals(const String& other) const { return s == other.s; }
+  bool equals(const char* c) const { return *this == c; }
+  bool equalsIgnoreCase(const String& other) const {
+    if (s.size() != other.s.size())
+      return false;
+    for (size_t i = 0; i < s.size(); i++)
+      if (tolower(s[i]) != tolower(other.s[i]))
+        return false;
+    return true;
+  }
+  bool startsWith(const String& prefix) const { return s.compare(0, prefix.s.size(), prefix.s) == 0; }
+  bool endsWith(const String& suffix) const { return s.size() >= suffix.s.size() && s.compare(s.size() - suffix.s.size(), suffix.s.size(), suffix.s) == 0; }
+
+  String substring(unsigned int from) const { return from >= s.size() ? String() : String(s.c_str() + from); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to)
+      std::swap(from, to);
+    if (from >= s.size())
+      return String();
+    if (to > s.size())
+      to = s.size();
+    return String(s.c_str() + from, to - from);
+  }
+  int indexOf(char c, unsigned int from = 0) const { size_t p = s.find(c, from); return p == std::string::npos ? -1 : (int)p; }
+  int indexOf(const String& str, unsigned int from = 0) const { size_t p = s.find(str.s, from); return p == std::string::npos ? -1 : (int)p; }
+  int lastIndexOf(char c) const { size_t p = s.rfind(c); return p == std::string::npos ? -1 : (int)p; }
+  void replace(const String& find, const String& replacement) {
+    if (find.s.empty())
+      return;
+    size_t p = 0;
+    while ((p = s.find(find.s, p)) != std::string::npos) {
+      s.replace(p, find.s.size(), replacement.s);
+      p += replacement.s.size();
+    }
+  }
+  void remove(unsigned int index) { if (index < s.size()) s.erase(index); }
+  void remove(unsigned int index, unsigned int count) { if (index < s.size()) s.erase(index, count); }
+  void toLowerCase() { for (char& c : s) c = tolower(c); }
+  void toUpperCase() { for (char& c : s) c = toupper(c); }
+  void trim() {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    size_t e = s.find_last_not_of(" \t\r\n");
+    s = (b == std::string::npos ? std::string() : s.substr(b, e - b + 1));
+  }
+  long toInt() const { return atol(s.c_str()); }
+  float toFloat() const { return atof(s.c_str()); }
+  double toDouble() const { return atof(s.c_str()); }
+
+  char* begin() { return s.data(); }
+  const char* begin() const { return s.data(); }
+  char* end() { return s.data() + s.size(); }
+  const char* end() const { return s.data() + s.size(); }
+};
+
+template<typename T>
+inline String operator+(const String& a, const T& b) { String r(a); r.concat(b); return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r.concat(b); return r; }
+inline String operator+(const __FlashStringHelper* a, const String& b) { String r(a); r.concat(b); return r; }
+inline bool operator==(const char* a, const String& b) { return b == a; }
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size-- > 0)
+      n += write(*buffer++);
+    return n;
+  }
+  size_t write(const char* s) { return s != nullptr ? write((const uint8_t*)s, strlen(s)) : 0; }
+  size_t write(const char* s, size_t size) { return write((const uint8_t*)s, size); }
+  virtual void flush() {}
+
+  size_t print(const char* s) { return write(s); }
+  size_t print(const String& s) { return write(s.c_str(), s.length()); }
+  size_t print(const __FlashStringHelper* s) { return write((const char*)s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  template<typename N, typename std::enable_if<std::is_arithmetic_v<N> && !std::is_same_v<N, char>, int>::type = 0>
+  size_t print(N n) { return print(String(n)); }
+  size_t println() { return write("\r\n"); }
+  template<typename T>
+  size_t println(const T& value) { return print(value) + println(); }
+
+  size_t vprintf(const char* format, va_list args) {
+    char buffer[256];
+    va_list copy;
+    va_copy(copy, args);
+    int n = vsnprintf(buffer, sizeof(buffer), format, copy);
+    va_end(copy);
+    if (n < 0)
+      return 0;
+    if ((size_t)n < sizeof(buffer))
+      return write(buffer, n);
+    std::string large(n + 1, '\0');
+    vsnprintf(large.data(), large.size(), format, args);
+    return write(large.data(), n);
+  }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    va_list args;
+    va_start(args, format);
+    size_t n = vprintf(format, args);
+    va_end(args);
+    return n;
+  }
+  size_t printf_P(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t n = vprintf(format, args);
+    va_end(args);
+    return n;
+  }
+};
+
+class Printable {
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print& p) const = 0;
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+class IPAddress {
+  uint8_t bytes[4] = {};
+
+public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{ a, b, c, d } {}
+  uint8_t operator[](int i) const { return bytes[i]; }
+  String toString() const { return String(bytes[0]) + "." + String(bytes[1]) + "." + String(bytes[2]) + "." + String(bytes[3]); }
+};
+
+// Serial port that writes to stdout.
+class HostSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+  size_t write(const uint8_t* buffer, size_t size) override { return fwrite(buffer, 1, size, stdout); }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  operator bool() const { return true; }
+};
+
+inline HostSerial Serial;
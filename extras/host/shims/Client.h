@@ -0,0 +1,44 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host build: Arduino Client interface
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Arduino.h"
+
+class Client : public Stream {
+public:
+  virtual int connect(IPAddress ip, uint16_t port) = 0;
+  virtual int connect(const char* host, uint16_t port) = 0;
+  using Print::write;
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) = 0;
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int read(uint8_t* buffer, size_t size) = 0;
+  virtual int peek() = 0;
+  virtual void flush() = 0;
+  virtual void stop() = 0;
+  virtual uint8_t connected() = 0;
+  virtual operator bool() = 0;
+};
+
+// Client that is never connected. Sufficient for the in-memory PubSubClient, which does not use it.
+class NullClient : public Client {
+public:
+  int connect(IPAddress, uint16_t) override { return 0; }
+  int connect(const char*, uint16_t) override { return 0; }
+  size_t write(uint8_t) override { return 0; }
+  size_t write(const uint8_t*, size_t) override { return 0; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int read(uint8_t*, size_t) override { return -1; }
+  int peek() override { return -1; }
+  void flush() override {}
+  void stop() override {}
+  uint8_t connected() override { return 0; }
+  operator bool() override { return false; }
+};
@@ -0,0 +1,196 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host build: in-memory PubSubClient stand-in
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// Implements the PubSubClient API without a network. Publishes and subscriptions are recorded,
+// incoming messages are injected by the test code. Used by the benchmarks and unit tests.
+
+#pragma once
+
+#include "Arduino.h"
+#include "Client.h"
+#include <string>
+#include <vector>
+#include <deque>
+
+#define MQTT_VERSION_3_1_1          4
+#define MQTT_VERSION                MQTT_VERSION_3_1_1
+#define MQTT_MAX_PACKET_SIZE        256
+#define MQTT_KEEPALIVE              15
+#define MQTT_SOCKET_TIMEOUT         15
+
+#define MQTT_CONNECTION_TIMEOUT     -4
+#define MQTT_CONNECTION_LOST        -3
+#define MQTT_CONNECT_FAILED         -2
+#define MQTT_DISCONNECTED           -1
+#define MQTT_CONNECTED               0
+#define MQTT_CONNECT_BAD_PROTOCOL    1
+#define MQTT_CONNECT_BAD_CLIENT_ID   2
+#define MQTT_CONNECT_UNAVAILABLE     3
+#define MQTT_CONNECT_BAD_CREDENTIALS 4
+#define MQTT_CONNECT_UNAUTHORIZED    5
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+class PubSubClient : public Print {
+public:
+  struct Message {
+    std::string topic;
+    std::string payload;
+    bool retained;
+  };
+
+  // recorded traffic; publishes are only stored while recording is enabled
+  std::vector<Message> published;
+  std::vector<std::string> subscriptions;
+  size_t publishCount = 0;
+  size_t publishedBytes = 0;
+  size_t lengthMismatches = 0;  // streamed publishes whose written length differs from the announced one
+  bool recording = true;
+
+  // simulated broker behavior
+  bool brokerAvailable = true;
+  bool failPublishes = false;
+
+private:
+  std::function<void(char*, uint8_t*, unsigned int)> messageCallback;
+  Client* client = nullptr;
+  int mqttState = MQTT_DISCONNECTED;
+  uint16_t bufferSize = MQTT_MAX_PACKET_SIZE;
+  std::deque<Message> inbox;
+  std::string deliveryBuffer;
+  Message current;
+  size_t announcedLength = 0;
+  bool streaming = false;
+
+  bool doConnect() {
+    if (!brokerAvailable) {
+      mqttState = MQTT_CONNECT_FAILED;
+      return false;
+    }
+    mqttState = MQTT_CONNECTED;
+    return true;
+  };
+
+  void record(Message&& message) {
+    publishCount++;
+    publishedBytes += message.topic.size() + message.payload.size();
+    if (recording)
+      published.push_back(std::move(message));
+  };
+
+public:
+  PubSubClient() {}
+  PubSubClient(Client& aClient) : client(&aClient) {}
+
+  PubSubClient& setServer(const char*, uint16_t) { return *this; }
+  PubSubClient& setServer(IPAddress, uint16_t) { return *this; }
+  PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE) { messageCallback = callback; return *this; }
+  PubSubClient& setClient(Client& aClient) { client = &aClient; return *this; }
+  PubSubClient& setKeepAlive(uint16_t) { return *this; }
+  PubSubClient& setSocketTimeout(uint16_t) { return *this; }
+  bool setBufferSize(uint16_t size) { bufferSize = size; return true; }
+  uint16_t getBufferSize() { return bufferSize; }
+
+  bool connect(const char*) { return doConnect(); }
+  bool connect(const char*, const char*, const char*) { return doConnect(); }
+  bool connect(const char*, const char*, uint8_t, bool, const char*) { return doConnect(); }
+  bool connect(const char*, const char*, const char*, const char*, uint8_t, bool, const char*) { return doConnect(); }
+  bool connect(const char*, const char*, const char*, const char*, uint8_t, bool, const char*, bool) { return doConnect(); }
+  void disconnect() { mqttState = MQTT_DISCONNECTED; }
+
+  bool publish(const char* topic, const char* payload) { return publish(topic, payload, false); }
+  bool publish(const char* topic, const char* payload, bool retained) {
+    return publish(topic, (const uint8_t*)payload, payload != nullptr ? strlen(payload) : 0, retained);
+  }
+  bool publish(const char* topic, const uint8_t* payload, unsigned int length) { return publish(topic, payload, length, false); }
+  bool publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained) {
+    if (!connected() || failPublishes)
+      return false;
+    record(Message{ topic, std::string((const char*)payload, length), retained });
+    return true;
+  }
+
+  bool beginPublish(const char* topic, unsigned int length, bool retained) {
+    if (!connected() || failPublishes)
+      return false;
+    current = Message{ topic, std::string(), retained };
+    announcedLength = length;
+    streaming = true;
+    return true;
+  }
+  size_t write(uint8_t c) override {
+    return write(&c, 1);
+  }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    if (!streaming)
+      return 0;
+    current.payload.append((const char*)buffer, size);
+    return size;
+  }
+  int endPublish() {
+    if (!streaming)
+      return 0;
+    streaming = false;
+    // the real client has already sent the announced length; a different amount corrupts the stream
+    if (current.payload.size() != announcedLength)
+      lengthMismatches++;
+    record(std::move(current));
+    return 1;
+  }
+
+  bool subscribe(const char* topic) { return subscribe(topic, 0); }
+  bool subscribe(const char* topic, uint8_t) {
+    if (!connected())
+      return false;
+    subscriptions.push_back(topic);
+    return true;
+  }
+  bool unsubscribe(const char*) { return connected(); }
+
+  bool loop() {
+    if (!connected())
+      return false;
+    while (!inbox.empty()) {
+      Message message = std::move(inbox.front());
+      inbox.pop_front();
+      deliver(message.topic.c_str(), message.payload);
+    }
+    return true;
+  }
+
+  bool connected() { return mqttState == MQTT_CONNECTED; }
+  int state() { return mqttState; }
+
+  // Queues a message that is delivered by the next call of loop().
+  void inject(const char* topic, std::string_view payload) {
+    inbox.push_back(Message{ topic, std::string(payload), false });
+  }
+
+  // Delivers a message to the callback immediately. Like the real client, the payload is passed
+  // from an internal buffer that is not null-terminated after the payload.
+  void deliver(const char* topic, std::string_view payload) {
+    if (!messageCallback)
+      return;
+    std::string t(topic);
+    deliveryBuffer.assign(payload);
+    deliveryBuffer.append("\xff" "999");
+    messageCallback(t.data(), (uint8_t*)deliveryBuffer.data(), payload.length());
+  }
+
+  // Simulates the loss of the connection to the broker.
+  void dropConnection() {
+    mqttState = MQTT_CONNECTION_LOST;
+  }
+
+  void clearRecorded() {
+    published.clear();
+    subscriptions.clear();
+    publishCount = 0;
+    publishedBytes = 0;
+    lengthMismatches = 0;
+  }
+};
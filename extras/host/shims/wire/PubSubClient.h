@@ -0,0 +1,470 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host build: PubSubClient stand-in speaking MQTT 3.1.1
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// Implements the PubSubClient API on top of an Arduino Client with the same behavior as the
+// original library: QoS 0 publishes from a fixed-size buffer, streamed publishes that are written
+// directly to the network, at most one incoming packet per call of loop() and keep-alive pings.
+// Used by the end-to-end tests against the loopback broker.
+
+#pragma once
+
+#include "Arduino.h"
+#include "Client.h"
+
+#define MQTT_VERSION_3_1_1          4
+#define MQTT_VERSION                MQTT_VERSION_3_1_1
+#define MQTT_MAX_PACKET_SIZE        256
+#define MQTT_KEEPALIVE              15
+#define MQTT_SOCKET_TIMEOUT         15
+
+#define MQTT_CONNECTION_TIMEOUT     -4
+#define MQTT_CONNECTION_LOST        -3
+#define MQTT_CONNECT_FAILED         -2
+#define MQTT_DISCONNECTED           -1
+#define MQTT_CONNECTED               0
+#define MQTT_CONNECT_BAD_PROTOCOL    1
+#define MQTT_CONNECT_BAD_CLIENT_ID   2
+#define MQTT_CONNECT_UNAVAILABLE     3
+#define MQTT_CONNECT_BAD_CREDENTIALS 4
+#define MQTT_CONNECT_UNAUTHORIZED    5
+
+#define MQTTCONNECT     1 << 4
+#define MQTTCONNACK     2 << 4
+#define MQTTPUBLISH     3 << 4
+#define MQTTPUBACK      4 << 4
+#define MQTTSUBSCRIBE   8 << 4
+#define MQTTSUBACK      9 << 4
+#define MQTTUNSUBSCRIBE 10 << 4
+#define MQTTUNSUBACK    11 << 4
+#define MQTTPINGREQ     12 << 4
+#define MQTTPINGRESP    13 << 4
+#define MQTTDISCONNECT  14 << 4
+
+#define MQTTQOS0        (0 << 1)
+#define MQTTQOS1        (1 << 1)
+
+// maximum size of the fixed header (type byte and up to four bytes of remaining length)
+#define MQTT_MAX_HEADER_SIZE 5
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+class PubSubClient : public Print {
+private:
+  Client* client = nullptr;
+  uint8_t* buffer = nullptr;
+  uint16_t bufferSize = 0;
+  uint16_t keepAlive = MQTT_KEEPALIVE;
+  uint16_t socketTimeout = MQTT_SOCKET_TIMEOUT;
+  uint16_t nextMsgId = 0;
+  unsigned long lastOutActivity = 0;
+  unsigned long lastInActivity = 0;
+  bool pingOutstanding = false;
+  std::function<void(char*, uint8_t*, unsigned int)> messageCallback;
+  std::string domain;
+  IPAddress ip;
+  uint16_t port = 1883;
+  int mqttState = MQTT_DISCONNECTED;
+
+  // Reads a byte, waiting up to the socket timeout.
+  bool readByte(uint8_t* result) {
+    unsigned long start = millis();
+    while (!client->available()) {
+      yield();
+      if (millis() - start >= (unsigned long)socketTimeout * 1000)
+        return false;
+    }
+    *result = client->read();
+    return true;
+  };
+
+  // Reads a packet into the buffer. Returns its length or 0 if it could not be read or was too long.
+  uint32_t readPacket(uint8_t* lengthLength) {
+    uint8_t digit;
+    if (!readByte(&digit))
+      return 0;
+    buffer[0] = digit;
+    uint16_t len = 1;
+    uint32_t multiplier = 1;
+    uint32_t length = 0;
+    do {
+      if (len == MQTT_MAX_HEADER_SIZE) {
+        // invalid remaining length
+        mqttState = MQTT_DISCONNECTED;
+        client->stop();
+        return 0;
+      }
+      if (!readByte(&digit))
+        return 0;
+      buffer[len++] = digit;
+      length += (digit & 127) * multiplier;
+      multiplier <<= 7;
+    } while ((digit & 128) != 0);
+    *lengthLength = len - 1;
+    // bytes beyond the buffer are read but discarded
+    uint32_t index = len;
+    for (uint32_t i = 0; i < length; i++) {
+      if (!readByte(&digit))
+        return 0;
+      if (index < bufferSize)
+        buffer[index] = digit;
+      index++;
+    }
+    return index <= bufferSize ? index : 0;
+  };
+
+  // Encodes the remaining length and writes the fixed header in front of the data at buf + MQTT_MAX_HEADER_SIZE.
+  // Returns the size of the header.
+  size_t buildHeader(uint8_t header, uint8_t* buf, uint16_t length) {
+    uint8_t lenBuf[4];
+    uint8_t llen = 0;
+    uint16_t len = length;
+    do {
+      uint8_t digit = len & 127;
+      len >>= 7;
+      if (len > 0)
+        digit |= 0x80;
+      lenBuf[llen++] = digit;
+    } while (len > 0);
+    buf[4 - llen] = header;
+    for (uint8_t i = 0; i < llen; i++)
+      buf[MQTT_MAX_HEADER_SIZE - llen + i] = lenBuf[i];
+    return llen + 1;
+  };
+
+  bool write(uint8_t header, uint8_t* buf, uint16_t length) {
+    size_t hlen = buildHeader(header, buf, length);
+    size_t rc = client->write(buf + (MQTT_MAX_HEADER_SIZE - hlen), length + hlen);
+    lastOutActivity = millis();
+    return rc == hlen + length;
+  };
+
+  uint16_t writeString(const char* string, uint8_t* buf, uint16_t pos) {
+    const char* idp = string;
+    uint16_t i = 0;
+    pos += 2;
+    while (*idp) {
+      buf[pos++] = *idp++;
+      i++;
+    }
+    buf[pos - i - 2] = (i >> 8);
+    buf[pos - i - 1] = (i & 0xFF);
+    return pos;
+  };
+
+  static bool fits(size_t length, size_t pos, uint16_t bufferSize) {
+    return length + 2 + pos <= bufferSize;
+  };
+
+public:
+  PubSubClient() {
+    setBufferSize(MQTT_MAX_PACKET_SIZE);
+  }
+
+  PubSubClient(Client& aClient) : PubSubClient() {
+    setClient(aClient);
+  }
+
+  ~PubSubClient() {
+    free(buffer);
+  }
+
+  PubSubClient& setServer(IPAddress anIp, uint16_t aPort) {
+    ip = anIp;
+    port = aPort;
+    domain.clear();
+    return *this;
+  }
+  PubSubClient& setServer(const char* aDomain, uint16_t aPort) {
+    domain = aDomain;
+    port = aPort;
+    return *this;
+  }
+  PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE) {
+    messageCallback = callback;
+    return *this;
+  }
+  PubSubClient& setClient(Client& aClient) {
+    client = &aClient;
+    return *this;
+  }
+  PubSubClient& setKeepAlive(uint16_t seconds) {
+    keepAlive = seconds;
+    return *this;
+  }
+  PubSubClient& setSocketTimeout(uint16_t seconds) {
+    socketTimeout = seconds;
+    return *this;
+  }
+
+  bool setBufferSize(uint16_t size) {
+    if (size == 0)
+      return false;
+    uint8_t* newBuffer = (uint8_t*)realloc(buffer, size);
+    if (newBuffer == nullptr)
+      return false;
+    buffer = newBuffer;
+    bufferSize = size;
+    return true;
+  }
+  uint16_t getBufferSize() {
+    return bufferSize;
+  }
+
+  bool connect(const char* id) { return connect(id, nullptr, nullptr, 0, 0, 0, 0, 1); }
+  bool connect(const char* id, const char* user, const char* pass) { return connect(id, user, pass, 0, 0, 0, 0, 1); }
+  bool connect(const char* id, const char* willTopic, uint8_t willQos, bool willRetain, const char* willMessage) {
+    return connect(id, nullptr, nullptr, willTopic, willQos, willRetain, willMessage, 1);
+  }
+  bool connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos, bool willRetain, const char* willMessage) {
+    return connect(id, user, pass, willTopic, willQos, willRetain, willMessage, 1);
+  }
+  bool connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos, bool willRetain, const char* willMessage, bool cleanSession) {
+    if (connected())
+      return true;
+    int result = (domain.empty() ? client->connect(ip, port) : client->connect(domain.c_str(), port));
+    if (result != 1) {
+      mqttState = MQTT_CONNECT_FAILED;
+      return false;
+    }
+    nextMsgId = 1;
+    uint16_t length = MQTT_MAX_HEADER_SIZE;
+    const uint8_t header[] = { 0x00, 0x04, 'M', 'Q', 'T', 'T', MQTT_VERSION };
+    for (uint8_t b : header)
+      buffer[length++] = b;
+
+    uint8_t v = 0;
+    if (willTopic != nullptr)
+      v = 0x04 | (willQos << 3) | (willRetain << 5);
+    if (cleanSession)
+      v |= 0x02;
+    if (user != nullptr) {
+      v |= 0x80;
+      if (pass != nullptr)
+        v |= 0x40;
+    }
+    buffer[length++] = v;
+    buffer[length++] = keepAlive >> 8;
+    buffer[length++] = keepAlive & 0xFF;
+
+    if (!fits(strlen(id), length, bufferSize))
+      return false;
+    length = writeString(id, buffer, length);
+    if (willTopic != nullptr) {
+      if (!fits(strlen(willTopic), length, bufferSize))
+        return false;
+      length = writeString(willTopic, buffer, length);
+      if (!fits(strlen(willMessage), length, bufferSize))
+        return false;
+      length = writeString(willMessage, buffer, length);
+    }
+    if (user != nullptr) {
+      if (!fits(strlen(user), length, bufferSize))
+        return false;
+      length = writeString(user, buffer, length);
+      if (pass != nullptr) {
+        if (!fits(strlen(pass), length, bufferSize))
+          return false;
+        length = writeString(pass, buffer, length);
+      }
+    }
+    write(MQTTCONNECT, buffer, length - MQTT_MAX_HEADER_SIZE);
+    lastInActivity = lastOutActivity = millis();
+
+    // wait for the CONNACK
+    while (!client->available()) {
+      yield();
+      if (millis() - lastInActivity >= (unsigned long)socketTimeout * 1000) {
+        mqttState = MQTT_CONNECTION_TIMEOUT;
+        client->stop();
+        return false;
+      }
+    }
+    uint8_t llen;
+    uint32_t len = readPacket(&llen);
+    if (len == 4) {
+      if (buffer[3] == 0) {
+        lastInActivity = millis();
+        pingOutstanding = false;
+        mqttState = MQTT_CONNECTED;
+        return true;
+      }
+      mqttState = buffer[3];
+    }
+    client->stop();
+    return false;
+  }
+
+  void disconnect() {
+    buffer[0] = MQTTDISCONNECT;
+    buffer[1] = 0;
+    client->write(buffer, 2);
+    mqttState = MQTT_DISCONNECTED;
+    client->flush();
+    client->stop();
+    lastInActivity = lastOutActivity = millis();
+  }
+
+  bool publish(const char* topic, const char* payload) {
+    return publish(topic, (const uint8_t*)payload, payload != nullptr ? strlen(payload) : 0, false);
+  }
+  bool publish(const char* topic, const char* payload, bool retained) {
+    return publish(topic, (const uint8_t*)payload, payload != nullptr ? strlen(payload) : 0, retained);
+  }
+  bool publish(const char* topic, const uint8_t* payload, unsigned int plength) {
+    return publish(topic, payload, plength, false);
+  }
+  bool publish(const char* topic, const uint8_t* payload, unsigned int plength, bool retained) {
+    if (!connected())
+      return false;
+    // the packet must fit into the buffer
+    if (bufferSize < MQTT_MAX_HEADER_SIZE + 2 + strlen(topic) + plength)
+      return false;
+    uint16_t length = writeString(topic, buffer, MQTT_MAX_HEADER_SIZE);
+    for (unsigned int i = 0; i < plength; i++)
+      buffer[length++] = payload[i];
+    uint8_t header = MQTTPUBLISH;
+    if (retained)
+      header |= 1;
+    return write(header, buffer, length - MQTT_MAX_HEADER_SIZE);
+  }
+
+  // Starts a publish whose payload is written directly to the network with write().
+  // Exactly plength bytes must be written before calling endPublish().
+  bool beginPublish(const char* topic, unsigned int plength, bool retained) {
+    if (!connected())
+      return false;
+    uint16_t length = writeString(topic, buffer, MQTT_MAX_HEADER_SIZE);
+    uint8_t header = MQTTPUBLISH;
+    if (retained)
+      header |= 1;
+    size_t hlen = buildHeader(header, buffer, plength + length - MQTT_MAX_HEADER_SIZE);
+    size_t rc = client->write(buffer + (MQTT_MAX_HEADER_SIZE - hlen), length - (MQTT_MAX_HEADER_SIZE - hlen));
+    lastOutActivity = millis();
+    return rc == (size_t)(length - (MQTT_MAX_HEADER_SIZE - hlen));
+  }
+  int endPublish() {
+    return 1;
+  }
+  size_t write(uint8_t data) override {
+    lastOutActivity = millis();
+    return client->write(data);
+  }
+  size_t write(const uint8_t* data, size_t size) override {
+    lastOutActivity = millis();
+    return client->write(data, size);
+  }
+
+  bool subscribe(const char* topic) {
+    return subscribe(topic, 0);
+  }
+  bool subscribe(const char* topic, uint8_t qos) {
+    size_t topicLength = strlen(topic);
+    if (qos > 1 || bufferSize < 9 + topicLength)
+      return false;
+    if (!connected())
+      return false;
+    uint16_t length = MQTT_MAX_HEADER_SIZE;
+    nextMsgId++;
+    if (nextMsgId == 0)
+      nextMsgId = 1;
+    buffer[length++] = (nextMsgId >> 8);
+    buffer[length++] = (nextMsgId & 0xFF);
+    length = writeString(topic, buffer, length);
+    buffer[length++] = qos;
+    return write(MQTTSUBSCRIBE | MQTTQOS1, buffer, length - MQTT_MAX_HEADER_SIZE);
+  }
+  bool unsubscribe(const char* topic) {
+    size_t topicLength = strlen(topic);
+    if (bufferSize < 9 + topicLength)
+      return false;
+    if (!connected())
+      return false;
+    uint16_t length = MQTT_MAX_HEADER_SIZE;
+    nextMsgId++;
+    if (nextMsgId == 0)
+      nextMsgId = 1;
+    buffer[length++] = (nextMsgId >> 8);
+    buffer[length++] = (nextMsgId & 0xFF);
+    length = writeString(topic, buffer, length);
+    return write(MQTTUNSUBSCRIBE | MQTTQOS1, buffer, length - MQTT_MAX_HEADER_SIZE);
+  }
+
+  // Sends keep-alive pings and processes at most one incoming packet.
+  bool loop() {
+    if (!connected())
+      return false;
+    unsigned long t = millis();
+    if (keepAlive > 0 && (t - lastInActivity > keepAlive * 1000UL || t - lastOutActivity > keepAlive * 1000UL)) {
+      if (pingOutstanding) {
+        mqttState = MQTT_CONNECTION_TIMEOUT;
+        client->stop();
+        return false;
+      }
+      buffer[0] = MQTTPINGREQ;
+      buffer[1] = 0;
+      client->write(buffer, 2);
+      lastOutActivity = lastInActivity = t;
+      pingOutstanding = true;
+    }
+    if (client->available()) {
+      uint8_t llen;
+      uint32_t len = readPacket(&llen);
+      if (len > 0) {
+        lastInActivity = t;
+        uint8_t type = buffer[0] & 0xF0;
+        if (type == MQTTPUBLISH) {
+          if (messageCallback) {
+            uint16_t tl = (buffer[llen + 1] << 8) + buffer[llen + 2];
+            // move the topic one byte to the front to terminate it
+            memmove(buffer + llen + 2, buffer + llen + 3, tl);
+            buffer[llen + 2 + tl] = 0;
+            char* topic = (char*)buffer + llen + 2;
+            if ((buffer[0] & 0x06) == MQTTQOS1) {
+              uint16_t msgId = (buffer[llen + 3 + tl] << 8) + buffer[llen + 3 + tl + 1];
+              uint8_t* payload = buffer + llen + 3 + tl + 2;
+              messageCallback(topic, payload, len - llen - 3 - tl - 2);
+              buffer[0] = MQTTPUBACK;
+              buffer[1] = 2;
+              buffer[2] = (msgId >> 8);
+              buffer[3] = (msgId & 0xFF);
+              client->write(buffer, 4);
+              lastOutActivity = t;
+            } else {
+              uint8_t* payload = buffer + llen + 3 + tl;
+              messageCallback(topic, payload, len - llen - 3 - tl);
+            }
+          }
+        } else if (type == MQTTPINGREQ) {
+          buffer[0] = MQTTPINGRESP;
+          buffer[1] = 0;
+          client->write(buffer, 2);
+        } else if (type == MQTTPINGRESP)
+          pingOutstanding = false;
+      } else if (!connected())
+        return false;
+    }
+    return true;
+  }
+
+  bool connected() {
+    if (client == nullptr)
+      return false;
+    if (!client->connected()) {
+      if (mqttState == MQTT_CONNECTED) {
+        mqttState = MQTT_CONNECTION_LOST;
+        client->flush();
+        client->stop();
+      }
+      return false;
+    }
+    return mqttState == MQTT_CONNECTED;
+  }
+
+  int state() {
+    return mqttState;
+  }
+};
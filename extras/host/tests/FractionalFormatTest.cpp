@@ -0,0 +1,196 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host tests: fixed precision conversion of floating point values
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// Compares fixedToChars(), roundDecimals() and the parsing of fractional values with the
+// snprintf() and strtod() round trips they replaced, including values close to decimal ties.
+
+#include <gtest/gtest.h>
+#include <SimpleMQTT.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace SimpleMQTT::__internal;
+
+namespace {
+
+  class StringPrint : public Print {
+  public:
+    std::string s;
+    size_t write(uint8_t c) override {
+      s += (char)c;
+      return 1;
+    }
+  };
+
+  std::string formatString(int decimals) {
+    return "%." + std::to_string(decimals) + "f";
+  }
+
+  std::string reference(double v, int decimals) {
+    char buffer[400];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimals, v);
+    return buffer;
+  }
+
+  // Previous parser: strtod() followed by a round trip through the format, with a buffer for all values
+  bool legacyParse(const std::string& s, double* value, const char* format) {
+    char* endptr;
+    double v = strtod(s.c_str(), &endptr);
+    if (s.empty() || *endptr != '\0')
+      return false;
+    char buffer[400];
+    snprintf(buffer, sizeof(buffer), format, v);
+    *value = strtod(buffer, &endptr);
+    return true;
+  }
+
+  // Random values of all magnitudes, signed zeros, exact ties and values next to the ties for the given decimals.
+  std::vector<double> testValues(int decimals) {
+    std::vector<double> values = { 0.0, -0.0, 0.5, -0.5, 1.5, 2.5, 0.125, 0.375, -2.675, 1.005, 1e15, 4.5e15, 1e300,
+                                   std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity(),
+                                   -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::denorm_min(),
+                                   std::numeric_limits<double>::max(), std::numeric_limits<double>::min() };
+    std::mt19937_64 random(decimals);
+    std::uniform_real_distribution<double> mantissa(-10, 10);
+    std::uniform_int_distribution<int> exponent(-12, 16);
+    for (int i = 0; i < 20000; i++)
+      values.push_back(mantissa(random) * pow(10, exponent(random)));
+    double scale = POWERS_OF_TEN[decimals];
+    for (int i = 0; i < 10000; i++) {
+      double tie = ((double)(random() % (1ULL << (random() % 50))) + 0.5) / scale;
+      values.push_back(tie);
+      double below = tie, above = tie;
+      for (int ulps = 1; ulps <= 3; ulps++) {
+        below = std::nextafter(below, 0);
+        above = std::nextafter(above, 1e300);
+        values.push_back(below);
+        values.push_back(-above);
+      }
+    }
+    // ties that are exact in binary
+    for (int i = 0; i < 2000; i++)
+      values.push_back((double)(random() % 1000000) / 1024);
+    return values;
+  }
+
+  class FractionalFormatTest : public ::testing::TestWithParam<int> {};
+
+}  // namespace
+
+TEST_P(FractionalFormatTest, FixedToCharsMatchesSnprintf) {
+  int decimals = GetParam();
+  for (double v : testValues(decimals)) {
+    char buffer[32];
+    size_t n = fixedToChars(buffer, v, decimals);
+    if (n > 0) {
+      ASSERT_EQ(std::string(buffer, n), reference(v, decimals)) << std::hexfloat << v;
+    }
+  }
+}
+
+TEST_P(FractionalFormatTest, FixedToCharsRarelyFallsBack) {
+  int decimals = GetParam();
+  std::mt19937_64 random(decimals);
+  std::uniform_real_distribution<double> values(-1000, 1000);
+  int converted = 0;
+  char buffer[32];
+  for (int i = 0; i < 10000; i++)
+    if (fixedToChars(buffer, values(random), decimals) > 0)
+      converted++;
+  EXPECT_GT(converted, 9900);
+}
+
+TEST_P(FractionalFormatTest, RoundDecimalsMatchesSnprintf) {
+  int decimals = GetParam();
+  for (double v : testValues(decimals)) {
+    uint64_t q;
+    if (!roundDecimals(v, decimals, &q))
+      continue;
+    std::string digits = reference(fabs(v), decimals);
+    digits.erase(std::remove(digits.begin(), digits.end(), '.'), digits.end());
+    ASSERT_EQ(q, std::stoull(digits)) << std::hexfloat << v;
+  }
+}
+
+TEST_P(FractionalFormatTest, FormatMatchesSnprintf) {
+  // includes the values that fall back to snprintf()
+  int decimals = GetParam();
+  std::string format = formatString(decimals);
+  FractionalFormat compiled(format.c_str());
+  ASSERT_EQ(compiled.decimals, decimals);
+  for (double v : testValues(decimals)) {
+    std::string expected = reference(v, decimals);
+    if (expected.size() >= SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER)
+      continue;
+    StringPrint out;
+    printValue(out, v, compiled);
+    ASSERT_EQ(out.s, expected) << std::hexfloat << v;
+    ASSERT_EQ(formatValue(v, compiled).c_str(), expected) << std::hexfloat << v;
+  }
+}
+
+TEST_P(FractionalFormatTest, ParseMatchesLegacy) {
+  int decimals = GetParam();
+  std::string format = formatString(decimals);
+  FractionalFormat compiled(format.c_str());
+  for (double v : testValues(decimals)) {
+    char payload[64];
+    snprintf(payload, sizeof(payload), "%.17g", v);
+    double expected = 0, parsed = 0;
+    bool ok = legacyParse(payload, &expected, format.c_str());
+    ASSERT_EQ(parseValue(std::string_view(payload), &parsed, compiled), ok) << payload;
+    if (!ok)
+      continue;
+    if (std::isnan(expected)) {
+      ASSERT_TRUE(std::isnan(parsed)) << payload;
+    } else {
+      ASSERT_EQ(parsed, expected) << payload;
+      ASSERT_EQ(std::signbit(parsed), std::signbit(expected)) << payload;
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Decimals, FractionalFormatTest, ::testing::Range(0, 10));
+
+TEST(FractionalFormat, Compile) {
+  EXPECT_EQ(FractionalFormat("%f").decimals, 6);
+  EXPECT_EQ(FractionalFormat("%.0f").decimals, 0);
+  EXPECT_EQ(FractionalFormat("%.9f").decimals, 9);
+  EXPECT_EQ(FractionalFormat("%.10f").decimals, -1);
+  EXPECT_EQ(FractionalFormat("%.3e").decimals, -1);
+  EXPECT_EQ(FractionalFormat("%5.2f").decimals, -1);
+  EXPECT_EQ(FractionalFormat("x%.2f").decimals, -1);
+  EXPECT_EQ(FractionalFormat(nullptr).decimals, -1);
+}
+
+TEST(FractionalFormat, Rounding) {
+  char buffer[32];
+  EXPECT_EQ(std::string(buffer, fixedToChars(buffer, -0.0, 2)), "-0.00");
+  EXPECT_EQ(std::string(buffer, fixedToChars(buffer, -0.004, 2)), "-0.00");
+  EXPECT_EQ(std::string(buffer, fixedToChars(buffer, 0.996, 2)), "1.00");
+  EXPECT_EQ(std::string(buffer, fixedToChars(buffer, 9.9996, 3)), "10.000");
+  EXPECT_EQ(std::string(buffer, fixedToChars(buffer, -123456.7, 0)), "-123457");
+  // exact ties and values beyond 64 bits are left to snprintf()
+  EXPECT_EQ(fixedToChars(buffer, 0.5, 0), 0u);
+  EXPECT_EQ(fixedToChars(buffer, 1e20, 2), 0u);
+  EXPECT_EQ(fixedToChars(buffer, std::numeric_limits<double>::quiet_NaN(), 2), 0u);
+}
+
+TEST(FractionalFormat, DefaultFormatMatchesString) {
+  // without a format the output is the one of String(value), i. e. dtostrf() with two decimals
+  for (double v : { 0.0, -0.0, 1.005, -2.675, 123456.789, 1e29, -1e29, 1e31, 1e300,
+                    std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity() }) {
+    StringPrint out;
+    printValue(out, v, FractionalFormat());
+    EXPECT_EQ(out.s, String(v).c_str()) << v;
+  }
+}
@@ -0,0 +1,190 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host tests: distributing the work of handle() over several calls
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// Runs the client on the manual clock of the Arduino stand-in. Topics whose get function advances
+// the clock simulate payloads that take a known time to format.
+
+#include <gtest/gtest.h>
+#include <SimpleMQTT.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+  template <typename C>
+  void connect(C& client) {
+    for (int i = 0; i < 10; i++)
+      client.handle();
+  }
+
+  std::vector<std::string> payloads(PubSubClient& broker, const std::string& topic) {
+    std::vector<std::string> result;
+    for (const PubSubClient::Message& m : broker.published)
+      if (m.topic == topic)
+        result.push_back(m.payload);
+    return result;
+  }
+
+  size_t publishCount(PubSubClient& broker, const std::string& prefix) {
+    size_t count = 0;
+    for (const PubSubClient::Message& m : broker.published)
+      if (m.topic.compare(0, prefix.length(), prefix) == 0)
+        count++;
+    return count;
+  }
+
+  // takes one millisecond to format
+  int slowValue = 0;
+  int slow() {
+    SimpleMQTTHost::advanceMillis(1);
+    return slowValue;
+  }
+
+  class Handle : public ::testing::Test {
+  protected:
+    NullClient network;
+    SimpleMQTTClient client{ network, "dev", "localhost" };
+    PubSubClient& broker = client;
+
+    void SetUp() override {
+      SimpleMQTTHost::setManualClock(true);
+      slowValue = 0;
+    }
+
+    void TearDown() override {
+      SimpleMQTTHost::setManualClock(false);
+    }
+  };
+
+}  // namespace
+
+TEST_F(Handle, ContinuesThePublishOfAllTopicsInTheNextCalls) {
+  const size_t TOPICS = 4;
+  for (size_t i = 0; i < TOPICS; i++)
+    client.add(String(("slow" + std::to_string(i)).c_str()), slow);
+  client.setHandleBudget(500);
+
+  // the first call connects, the following ones publish one topic each
+  client.handle();
+  EXPECT_EQ(publishCount(broker, "dev/slow"), 0u);
+  for (size_t i = 1; i <= TOPICS; i++) {
+    client.handle();
+    EXPECT_EQ(publishCount(broker, "dev/slow"), i);
+    if (i < TOPICS)
+      EXPECT_EQ(client.getLag(), i);
+  }
+  client.handle();
+  EXPECT_EQ(client.getLag(), 0u);
+  for (size_t i = 0; i < TOPICS; i++)
+    EXPECT_EQ(payloads(broker, "dev/slow" + std::to_string(i)).size(), 1u);
+}
+
+TEST_F(Handle, ContinuesThePublishOfChangedTopicsInTheNextCalls) {
+  const size_t TOPICS = 4;
+  std::vector<MQTTTopic*> topics;
+  for (size_t i = 0; i < TOPICS; i++)
+    topics.push_back(&client.add(String(("slow" + std::to_string(i)).c_str()), slow));
+  connect(client);
+  client.setHandleBudget(500);
+  broker.clearRecorded();
+
+  // at least one topic is processed per call even if it takes longer than the budget
+  slowValue = 1;
+  for (MQTTTopic* topic : topics)
+    topic->republish();
+  for (size_t i = 1; i <= TOPICS; i++) {
+    client.handle();
+    EXPECT_EQ(publishCount(broker, "dev/slow"), i);
+  }
+  client.handle();
+  EXPECT_EQ(client.getLag(), 0u);
+  for (size_t i = 0; i < TOPICS; i++)
+    EXPECT_EQ(payloads(broker, "dev/slow" + std::to_string(i)), (std::vector<std::string>{ "1" }));
+}
+
+TEST_F(Handle, CompletesAllWorkWithoutBudget) {
+  const size_t TOPICS = 4;
+  for (size_t i = 0; i < TOPICS; i++)
+    client.add(String(("slow" + std::to_string(i)).c_str()), slow);
+  client.handle();
+  client.handle();
+  EXPECT_EQ(publishCount(broker, "dev/slow"), TOPICS);
+  EXPECT_EQ(client.getLag(), 0u);
+}
+
+TEST_F(Handle, ChecksALimitedNumberOfTopicsPerCall) {
+  const size_t TOPICS = 6;
+  int32_t values[TOPICS] = {};
+  for (size_t i = 0; i < TOPICS; i++)
+    client.add(String(("value" + std::to_string(i)).c_str()), &values[i]);
+  connect(client);
+  client.setCheckLimit(2);
+  broker.clearRecorded();
+
+  for (int32_t& value : values)
+    value = 1;
+  for (size_t i = 1; i <= TOPICS / 2; i++) {
+    client.handle();
+    EXPECT_EQ(publishCount(broker, "dev/value"), 2 * i);
+  }
+  client.handle();
+  EXPECT_EQ(publishCount(broker, "dev/value"), TOPICS);
+}
+
+TEST_F(Handle, MeasuresTheDurationOfCompleteCheckPasses) {
+  const size_t TOPICS = 6;
+  int32_t values[TOPICS] = {};
+  for (size_t i = 0; i < TOPICS; i++)
+    client.add(String(("value" + std::to_string(i)).c_str()), &values[i]);
+  connect(client);
+  EXPECT_EQ(client.getSweepTime(), 0u);
+
+  // a pass takes three calls
+  client.setCheckLimit(2);
+  for (int i = 0; i < 2 * 3; i++) {
+    SimpleMQTTHost::advanceMillis(10);
+    client.handle();
+  }
+  EXPECT_EQ(client.getSweepTime(), 20u);
+  EXPECT_EQ(client.getMaxSweepTime(), 20u);
+
+  client.setCheckLimit(0);
+  SimpleMQTTHost::advanceMillis(10);
+  client.handle();
+  EXPECT_EQ(client.getSweepTime(), 0u);
+  EXPECT_EQ(client.getMaxSweepTime(), 20u);
+}
+
+TEST_F(Handle, ChecksTopicsAfterTheirCheckInterval) {
+  int32_t single = 0;
+  int32_t grouped = 0;
+  client.add("single", &single).setCheckInterval(1000);
+  MQTTGroup& group = client.add("group");
+  group.setCheckInterval(500);
+  group.add("value", &grouped);
+  connect(client);
+  broker.clearRecorded();
+
+  single = 1;
+  grouped = 1;
+  SimpleMQTTHost::advanceMillis(499);
+  client.handle();
+  EXPECT_TRUE(payloads(broker, "dev/single").empty());
+  EXPECT_TRUE(payloads(broker, "dev/group/value").empty());
+  // the subtopics are checked with the group
+  SimpleMQTTHost::advanceMillis(1);
+  client.handle();
+  EXPECT_TRUE(payloads(broker, "dev/single").empty());
+  EXPECT_EQ(payloads(broker, "dev/group/value"), (std::vector<std::string>{ "1" }));
+  SimpleMQTTHost::advanceMillis(499);
+  client.handle();
+  EXPECT_TRUE(payloads(broker, "dev/single").empty());
+  SimpleMQTTHost::advanceMillis(1);
+  client.handle();
+  EXPECT_EQ(payloads(broker, "dev/single"), (std::vector<std::string>{ "1" }));
+}
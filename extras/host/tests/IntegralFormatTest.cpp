@@ -0,0 +1,212 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host tests: integral conversion kernels
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// Compares integralToChars() and integralFromChars() with snprintf(), strtoll()/strtoull() and the
+// String conversions they replaced, for all integral types from 8 to 64 bits.
+
+#include <gtest/gtest.h>
+#include <SimpleMQTT.h>
+
+#include <cerrno>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace SimpleMQTT::__internal;
+
+namespace {
+
+  const IntegralFormat BASES[] = { IntegralFormat::DECIMAL, IntegralFormat::HEXADECIMAL, IntegralFormat::OCTAL };
+
+  template <typename T>
+  std::string toChars(T value, IntegralFormat format) {
+    char buffer[INTEGRAL_CHARS];
+    return std::string(buffer, integralToChars(buffer, value, format));
+  }
+
+  // Negative values are a minus sign followed by the magnitude in every base.
+  template <typename T>
+  std::string reference(T value, IntegralFormat format) {
+    const char* conversion = (format == IntegralFormat::DECIMAL ? "%llu" : format == IntegralFormat::HEXADECIMAL ? "%llx" : "%llo");
+    unsigned long long magnitude = (unsigned long long)value;
+    bool negative = false;
+    if constexpr (std::is_signed_v<T>) {
+      negative = value < 0;
+      if (negative)
+        magnitude = 0ULL - (unsigned long long)(long long)value;
+    }
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), conversion, magnitude);
+    return (negative ? "-" : "") + std::string(buffer);
+  }
+
+  // Parses with strtoll()/strtoull() and the range of T.
+  template <typename T>
+  bool referenceParse(const std::string& str, T* value, IntegralFormat format) {
+    int base = (int)format;
+    const char* s = str.c_str();
+    char* endptr;
+    errno = 0;
+    if constexpr (std::is_signed_v<T>) {
+      long long v = strtoll(s, &endptr, base);
+      if (endptr == s || *endptr != '\0' || errno == ERANGE || v < std::numeric_limits<T>::min() || v > std::numeric_limits<T>::max())
+        return false;
+      *value = (T)v;
+    } else {
+      // strtoull() negates negative values; only -0 fits
+      size_t sign = str.find_first_not_of(" \t\n\v\f\r");
+      bool negative = sign != std::string::npos && str[sign] == '-';
+      unsigned long long v = strtoull(s, &endptr, base);
+      if (endptr == s || *endptr != '\0' || errno == ERANGE || (negative && v != 0) || v > std::numeric_limits<T>::max())
+        return false;
+      *value = (T)v;
+    }
+    return true;
+  }
+
+  // Limits, powers of the bases and their neighbours, and random values of all magnitudes.
+  template <typename T>
+  std::vector<T> testValues() {
+    std::vector<T> values = { 0, 1, std::numeric_limits<T>::min(), std::numeric_limits<T>::max(),
+                              (T)(std::numeric_limits<T>::min() + 1), (T)(std::numeric_limits<T>::max() - 1) };
+    if constexpr (std::is_signed_v<T>)
+      values.push_back(-1);
+    for (unsigned base : { 8, 10, 16 })
+      for (unsigned long long p = 1; p <= (unsigned long long)std::numeric_limits<T>::max() / base; p *= base)
+        for (long long delta : { -1, 0, 1 }) {
+          values.push_back((T)(p * base + delta));
+          if constexpr (std::is_signed_v<T>)
+            values.push_back((T)(0 - (T)(p * base + delta)));
+        }
+    std::mt19937_64 random(42);
+    for (int i = 0; i < 20000; i++)
+      values.push_back((T)(random() >> (random() % 64)));
+    return values;
+  }
+
+  // Random strings of digits, signs, prefixes and whitespace.
+  std::vector<std::string> testStrings() {
+    std::vector<std::string> strings = { "", " ", "-", "+", "-0", "+0", "0x", "0x1g", "0X1F", "  12", "12 ", "1-2", "--1", "+-1", " - 1" };
+    const char alphabet[] = "0123456789012345678901234567890123456789abcdefABCDEFxX+- ";
+    std::mt19937_64 random(7);
+    for (int i = 0; i < 50000; i++) {
+      std::string s;
+      size_t length = random() % 24;
+      for (size_t j = 0; j < length; j++)
+        s += alphabet[random() % (sizeof(alphabet) - 1)];
+      strings.push_back(s);
+    }
+    // digits only, up to 24 characters, with and without sign
+    for (int i = 0; i < 50000; i++) {
+      std::string s = (i % 3 == 0 ? "-" : i % 3 == 1 ? "+" : "");
+      size_t length = 1 + random() % 24;
+      for (size_t j = 0; j < length; j++)
+        s += alphabet[random() % 16];
+      strings.push_back(s);
+    }
+    return strings;
+  }
+
+  template <typename T>
+  class IntegralFormatTest : public ::testing::Test {};
+
+  typedef ::testing::Types<int8_t, uint8_t, int16_t, uint16_t, int32_t, uint32_t, int64_t, uint64_t> IntegralTypes;
+  TYPED_TEST_SUITE(IntegralFormatTest, IntegralTypes);
+
+}  // namespace
+
+TYPED_TEST(IntegralFormatTest, ToCharsMatchesSnprintf) {
+  for (TypeParam value : testValues<TypeParam>())
+    for (IntegralFormat format : BASES)
+      ASSERT_EQ(toChars(value, format), reference(value, format)) << "base " << (int)format;
+}
+
+TYPED_TEST(IntegralFormatTest, ToCharsMatchesString) {
+  // the previous implementation used String(value, base); it differs only for negative values in other bases
+  for (TypeParam value : testValues<TypeParam>()) {
+    ASSERT_EQ(toChars(value, IntegralFormat::DECIMAL), String(value, 10).c_str());
+    if (value >= 0) {
+      ASSERT_EQ(toChars(value, IntegralFormat::HEXADECIMAL), String(value, 16).c_str());
+      ASSERT_EQ(toChars(value, IntegralFormat::OCTAL), String(value, 8).c_str());
+    }
+  }
+}
+
+TYPED_TEST(IntegralFormatTest, FromCharsRoundTrip) {
+  for (TypeParam value : testValues<TypeParam>())
+    for (IntegralFormat format : BASES) {
+      TypeParam parsed = 0;
+      ASSERT_TRUE(integralFromChars(toChars(value, format), &parsed, format));
+      ASSERT_EQ(parsed, value);
+    }
+}
+
+TYPED_TEST(IntegralFormatTest, FromCharsMatchesStrtoll) {
+  for (const std::string& s : testStrings())
+    for (IntegralFormat format : BASES) {
+      TypeParam expected = 0, parsed = 0;
+      bool ok = referenceParse(s, &expected, format);
+      ASSERT_EQ(integralFromChars(std::string_view(s), &parsed, format), ok) << "'" << s << "' base " << (int)format;
+      if (ok) {
+        ASSERT_EQ(parsed, expected) << "'" << s << "' base " << (int)format;
+      }
+    }
+}
+
+TYPED_TEST(IntegralFormatTest, FromCharsRejectsOverflow) {
+  // one beyond each limit, in every base
+  typedef TypeParam T;
+  for (IntegralFormat format : BASES) {
+    T parsed = 0;
+    if (std::numeric_limits<T>::max() < std::numeric_limits<unsigned long long>::max()) {
+      std::string above = reference((unsigned long long)std::numeric_limits<T>::max() + 1, format);
+      EXPECT_FALSE(integralFromChars(std::string_view(above), &parsed, format)) << above;
+    }
+    if constexpr (std::is_signed_v<T>) {
+      std::string below = "-" + reference((unsigned long long)std::numeric_limits<T>::max() + 2, format);
+      EXPECT_FALSE(integralFromChars(std::string_view(below), &parsed, format)) << below;
+    } else {
+      EXPECT_FALSE(integralFromChars(std::string_view("-1"), &parsed, format));
+    }
+    // a digit more than the longest value
+    EXPECT_FALSE(integralFromChars(std::string_view(reference(std::numeric_limits<T>::max(), format) + "0"), &parsed, format));
+  }
+}
+
+TEST(IntegralFormat, Limits64Bit) {
+  int64_t i = 0;
+  EXPECT_TRUE(integralFromChars(std::string_view("-9223372036854775808"), &i, IntegralFormat::DECIMAL));
+  EXPECT_EQ(i, std::numeric_limits<int64_t>::min());
+  EXPECT_FALSE(integralFromChars(std::string_view("-9223372036854775809"), &i, IntegralFormat::DECIMAL));
+  EXPECT_FALSE(integralFromChars(std::string_view("9223372036854775808"), &i, IntegralFormat::DECIMAL));
+  EXPECT_TRUE(integralFromChars(std::string_view("-0x8000000000000000"), &i, IntegralFormat::HEXADECIMAL));
+  EXPECT_EQ(i, std::numeric_limits<int64_t>::min());
+
+  uint64_t u = 0;
+  EXPECT_TRUE(integralFromChars(std::string_view("18446744073709551615"), &u, IntegralFormat::DECIMAL));
+  EXPECT_EQ(u, std::numeric_limits<uint64_t>::max());
+  EXPECT_FALSE(integralFromChars(std::string_view("18446744073709551616"), &u, IntegralFormat::DECIMAL));
+  EXPECT_FALSE(integralFromChars(std::string_view("99999999999999999999"), &u, IntegralFormat::DECIMAL));
+  EXPECT_TRUE(integralFromChars(std::string_view("1777777777777777777777"), &u, IntegralFormat::OCTAL));
+  EXPECT_EQ(u, std::numeric_limits<uint64_t>::max());
+  EXPECT_FALSE(integralFromChars(std::string_view("2000000000000000000000"), &u, IntegralFormat::OCTAL));
+
+  EXPECT_EQ(toChars(std::numeric_limits<int64_t>::min(), IntegralFormat::DECIMAL), "-9223372036854775808");
+  EXPECT_EQ(toChars(std::numeric_limits<int64_t>::min(), IntegralFormat::OCTAL), "-1000000000000000000000");
+  EXPECT_EQ(toChars(std::numeric_limits<uint64_t>::max(), IntegralFormat::HEXADECIMAL), "ffffffffffffffff");
+  EXPECT_EQ(toChars(std::numeric_limits<int32_t>::min(), IntegralFormat::DECIMAL), "-2147483648");
+}
+
+TEST(IntegralFormat, FromCharsDoesNotReadPastTheView) {
+  // payloads are not terminated
+  const char payload[] = "1234567";
+  int32_t value = 0;
+  EXPECT_TRUE(integralFromChars(std::string_view(payload, 3), &value, IntegralFormat::DECIMAL));
+  EXPECT_EQ(value, 123);
+  EXPECT_FALSE(integralFromChars(std::string_view(payload, 0), &value, IntegralFormat::DECIMAL));
+}
@@ -0,0 +1,109 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host tests: memory pools
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// Without static memory, small objects are allocated in blocks of fixed size classes from heap
+// slabs. These tests check the size classes, the reuse of released blocks, the alignment of the
+// blocks and the individual allocation of large blocks.
+
+#include <gtest/gtest.h>
+#include <SimpleMQTT.h>
+
+#include <string>
+#include <vector>
+
+using namespace SimpleMQTT::__internal;
+
+namespace {
+
+  class StringPrint : public Print {
+  public:
+    std::string text;
+
+    size_t write(uint8_t c) override {
+      text += (char)c;
+      return 1;
+    }
+  };
+
+}  // namespace
+
+TEST(Memory, UsesTheSmallestFittingSizeClass) {
+  EXPECT_EQ(memClassSize(memClass(1)), 8u);
+  EXPECT_EQ(memClassSize(memClass(8)), 8u);
+  EXPECT_EQ(memClassSize(memClass(9)), 12u);
+  EXPECT_EQ(memClassSize(memClass(13)), 16u);
+  EXPECT_EQ(memClassSize(memClass(40)), 48u);
+  EXPECT_EQ(memClassSize(memClass(49)), 64u);
+  EXPECT_EQ(memClassSize(memClass(SIMPLEMQTT_MAX_BLOCK_SIZE)), (size_t)SIMPLEMQTT_MAX_BLOCK_SIZE);
+  EXPECT_EQ(memClassSize(MEM_CLASSES - 1), (size_t)SIMPLEMQTT_MAX_BLOCK_SIZE);
+}
+
+TEST(Memory, ReusesReleasedBlocks) {
+  void* a = allocateBlock(20);
+  void* b = allocateBlock(20);
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  EXPECT_NE(a, b);
+  uint16_t used = memoryPools[memClass(20)].used;
+  deallocateBlock(a, 20);
+  EXPECT_EQ(memoryPools[memClass(20)].used, used - 1);
+  // a block of the same size class is taken from the free list
+  EXPECT_EQ(allocateBlock(24), a);
+  deallocateBlock(a, 24);
+  deallocateBlock(b, 20);
+}
+
+TEST(Memory, TakesSmallBlocksFromSlabs) {
+  uint16_t slabs = heapSlabs;
+  std::vector<uint8_t*> blocks;
+  for (int i = 0; i < 32; i++)
+    blocks.push_back((uint8_t*)allocateBlock(16));
+  // 32 blocks of 16 bytes fit into two slabs of 512 bytes
+  EXPECT_LE(heapSlabs - slabs, 2);
+  EXPECT_GE(heapSlabs - slabs, 1);
+  size_t adjacent = 0;
+  for (size_t i = 1; i < blocks.size(); i++)
+    if (blocks[i] == blocks[i - 1] + 16)
+      adjacent++;
+  EXPECT_GE(adjacent, blocks.size() - 2);
+  for (uint8_t* block : blocks)
+    deallocateBlock(block, 16);
+}
+
+TEST(Memory, AlignsBlocksToTheirSize) {
+  std::vector<std::pair<void*, size_t>> blocks;
+  for (size_t length : { 9, 8, 12, 16, 24, 1, 32, 48, 64 }) {
+    void* block = allocateBlock(length);
+    ASSERT_NE(block, nullptr);
+    size_t size = memClassSize(memClass(length));
+    size_t align = std::min(size & (~size + 1), alignof(std::max_align_t));
+    EXPECT_EQ((uintptr_t)block % align, 0u) << length;
+    blocks.push_back({ block, length });
+  }
+  for (auto& block : blocks)
+    deallocateBlock(block.first, block.second);
+}
+
+TEST(Memory, AllocatesLargeBlocksIndividually) {
+  uint16_t slabs = heapSlabs;
+  void* block = allocateBlock(SIMPLEMQTT_HEAP_SLAB_SIZE);
+  ASSERT_NE(block, nullptr);
+  memset(block, 0, SIMPLEMQTT_HEAP_SLAB_SIZE);
+  EXPECT_EQ(heapSlabs, slabs);
+  deallocateBlock(block, SIMPLEMQTT_HEAP_SLAB_SIZE);
+}
+
+TEST(Memory, AllocatesTopicsFromPools) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  int32_t value = 0;
+  client.add("value", &value);
+  StringPrint usage;
+  SimpleMQTTClient::printMemoryUsage(usage);
+  EXPECT_NE(usage.text.find(" bytes: used "), std::string::npos) << usage.text;
+  EXPECT_NE(usage.text.find("slabs: "), std::string::npos) << usage.text;
+}
@@ -0,0 +1,195 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host tests: recording publishes while disconnected
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// Built with a small SIMPLEMQTT_OFFLINE_BUFFER. The broker of the memory PubSubClient is made
+// unavailable to keep the client disconnected while the values change. The tests run on the
+// manual clock of the Arduino stand-in.
+
+#include <gtest/gtest.h>
+#include <SimpleMQTT.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+  // number of records with a payload of one byte that fit into the buffer
+  const size_t CAPACITY = SIMPLEMQTT_OFFLINE_BUFFER / (sizeof(SimpleMQTT::__internal::OfflineBuffer::Record) + 1);
+
+  template <typename C>
+  void connect(C& client) {
+    for (int i = 0; i < 10; i++)
+      client.handle();
+  }
+
+  std::vector<std::string> payloads(PubSubClient& broker, const std::string& topic) {
+    std::vector<std::string> result;
+    for (const PubSubClient::Message& m : broker.published)
+      if (m.topic == topic)
+        result.push_back(m.payload);
+    return result;
+  }
+
+  int functionCalls = 0;
+  int function() {
+    return ++functionCalls;
+  }
+
+  class OfflineBuffer : public ::testing::Test {
+  protected:
+    NullClient network;
+    SimpleMQTTClient client{ network, "dev", "localhost" };
+    PubSubClient& broker = client;
+
+    void SetUp() override {
+      SimpleMQTTHost::setManualClock(true);
+      client.setReconnectDelay(0, 0);
+    }
+
+    void TearDown() override {
+      SimpleMQTTHost::setManualClock(false);
+    }
+
+    void disconnect() {
+      broker.brokerAvailable = false;
+      broker.dropConnection();
+      client.handle();
+      broker.clearRecorded();
+    }
+
+    void reconnect() {
+      broker.brokerAvailable = true;
+      connect(client);
+    }
+  };
+
+}  // namespace
+
+TEST_F(OfflineBuffer, RecordsBufferedTopicsOnly) {
+  auto& buffered = client.add<int>("buffered", 0);
+  buffered.setBuffered(true);
+  auto& other = client.add<int>("other", 0);
+  MQTTTopic& counted = client.add("function", function);
+  connect(client);
+
+  disconnect();
+  buffered = 1;
+  client.handle();
+  buffered = 2;
+  other = 5;
+  int calls = functionCalls;
+  counted.republish();
+  connect(client);
+  EXPECT_EQ(client.getOfflinePending(), 2u);
+  EXPECT_EQ(client.getOfflineStatistics().stored, 2u);
+  // topics that are not buffered are not formatted while disconnected
+  EXPECT_EQ(functionCalls, calls);
+  EXPECT_TRUE(other.needsPublish());
+
+  // the current value has already been recorded and is not published again
+  reconnect();
+  EXPECT_EQ(payloads(broker, "dev/buffered"), (std::vector<std::string>{ "1", "2" }));
+  EXPECT_EQ(payloads(broker, "dev/other"), (std::vector<std::string>{ "5" }));
+  EXPECT_EQ(client.getOfflinePending(), 0u);
+  EXPECT_EQ(client.getOfflineStatistics().sent, 2u);
+}
+
+TEST_F(OfflineBuffer, DropsTheOldestRecordsWhenFull) {
+  auto& buffered = client.add<int>("buffered", 0);
+  buffered.setBuffered(true);
+  client.setOfflinePolicy(OfflinePolicy::DROP_OLDEST);
+  connect(client);
+
+  disconnect();
+  for (size_t i = 1; i <= CAPACITY + 2; i++) {
+    buffered = (int)(i % 10);
+    client.handle();
+  }
+  connect(client);
+  EXPECT_EQ(client.getOfflinePending(), CAPACITY);
+  EXPECT_EQ(client.getOfflineStatistics().dropped, 2u);
+
+  reconnect();
+  std::vector<std::string> sent = payloads(broker, "dev/buffered");
+  ASSERT_EQ(sent.size(), CAPACITY);
+  for (size_t i = 0; i < CAPACITY; i++)
+    EXPECT_EQ(sent[i], std::to_string((i + 3) % 10));
+}
+
+TEST_F(OfflineBuffer, DropsTheNewestPublishesWhenFull) {
+  auto& buffered = client.add<int>("buffered", 0);
+  buffered.setBuffered(true);
+  client.setOfflinePolicy(OfflinePolicy::DROP_NEWEST);
+  connect(client);
+
+  disconnect();
+  for (size_t i = 1; i <= CAPACITY + 2; i++) {
+    buffered = (int)(i % 10);
+    client.handle();
+  }
+  // a dropped publish is counted once and not retried on the following calls
+  connect(client);
+  EXPECT_EQ(client.getOfflinePending(), CAPACITY);
+  EXPECT_EQ(client.getOfflineStatistics().dropped, 2u);
+  EXPECT_FALSE(buffered.needsPublish());
+
+  reconnect();
+  std::vector<std::string> sent = payloads(broker, "dev/buffered");
+  ASSERT_EQ(sent.size(), CAPACITY);
+  for (size_t i = 0; i < CAPACITY; i++)
+    EXPECT_EQ(sent[i], std::to_string((i + 1) % 10));
+}
+
+TEST_F(OfflineBuffer, DiscardsRecordsOlderThanTheMaximumAge) {
+  auto& buffered = client.add<int>("buffered", 0);
+  buffered.setBuffered(true);
+  client.setOfflineMaxAge(1000);
+  connect(client);
+
+  disconnect();
+  buffered = 1;
+  client.handle();
+  SimpleMQTTHost::advanceMillis(1500);
+  buffered = 2;
+  client.handle();
+  SimpleMQTTHost::advanceMillis(500);
+
+  reconnect();
+  EXPECT_EQ(payloads(broker, "dev/buffered"), (std::vector<std::string>{ "2" }));
+  EXPECT_EQ(client.getOfflineStatistics().expired, 1u);
+  EXPECT_EQ(client.getOfflineStatistics().sent, 1u);
+}
+
+TEST_F(OfflineBuffer, LimitsTheDrainRate) {
+  auto& buffered = client.add<int>("buffered", 0);
+  buffered.setBuffered(true);
+  client.setOfflineDrainRate(10);
+  connect(client);
+
+  disconnect();
+  for (int i = 1; i <= 4; i++) {
+    buffered = i;
+    client.handle();
+  }
+  EXPECT_EQ(client.getOfflinePending(), 4u);
+
+  // one record per 100 ms
+  reconnect();
+  EXPECT_EQ(client.getOfflineStatistics().sent, 1u);
+  SimpleMQTTHost::advanceMillis(50);
+  client.handle();
+  EXPECT_EQ(client.getOfflineStatistics().sent, 1u);
+  SimpleMQTTHost::advanceMillis(50);
+  client.handle();
+  EXPECT_EQ(client.getOfflineStatistics().sent, 2u);
+  for (int i = 0; i < 3; i++) {
+    SimpleMQTTHost::advanceMillis(100);
+    connect(client);
+  }
+  EXPECT_EQ(client.getOfflineStatistics().sent, 4u);
+  EXPECT_EQ(payloads(broker, "dev/buffered"), (std::vector<std::string>{ "1", "2", "3", "4" }));
+}
@@ -0,0 +1,123 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host tests: minimum and maximum publish intervals
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// Runs the client on the manual clock of the Arduino stand-in so that the publishes can be checked
+// at exact points in time relative to the publish intervals.
+
+#include <gtest/gtest.h>
+#include <SimpleMQTT.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+  template <typename C>
+  void connect(C& client) {
+    for (int i = 0; i < 10; i++)
+      client.handle();
+  }
+
+  std::vector<std::string> payloads(PubSubClient& broker, const std::string& topic) {
+    std::vector<std::string> result;
+    for (const PubSubClient::Message& m : broker.published)
+      if (m.topic == topic)
+        result.push_back(m.payload);
+    return result;
+  }
+
+  class PublishInterval : public ::testing::Test {
+  protected:
+    void SetUp() override {
+      SimpleMQTTHost::setManualClock(true);
+    }
+
+    void TearDown() override {
+      SimpleMQTTHost::setManualClock(false);
+    }
+
+    // Advances the clock in steps of the timer resolution and calls handle() after each step.
+    template <typename C>
+    void run(C& client, uint32_t ms) {
+      for (uint32_t t = 0; t < ms; t += SIMPLEMQTT_TIMER_RESOLUTION) {
+        SimpleMQTTHost::advanceMillis(SIMPLEMQTT_TIMER_RESOLUTION);
+        client.handle();
+      }
+    }
+  };
+
+}  // namespace
+
+TEST_F(PublishInterval, PublishesTheLatestValueAtTheEndOfTheMinimumInterval) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  auto& value = client.add<int>("value", 0);
+  value.setPublishInterval(1000, 0);
+  connect(client);
+  PubSubClient& broker = client;
+  broker.clearRecorded();
+
+  value = 1;
+  run(client, 300);
+  value = 2;
+  run(client, 300);
+  value = 3;
+  client.handle();
+  EXPECT_TRUE(payloads(broker, "dev/value").empty());
+  run(client, 400 + 2 * SIMPLEMQTT_TIMER_RESOLUTION);
+  EXPECT_EQ(payloads(broker, "dev/value"), (std::vector<std::string>{ "3" }));
+
+  // the next change waits for the minimum interval after this publish
+  broker.clearRecorded();
+  value = 4;
+  run(client, 500);
+  EXPECT_TRUE(payloads(broker, "dev/value").empty());
+  run(client, 500 + 2 * SIMPLEMQTT_TIMER_RESOLUTION);
+  EXPECT_EQ(payloads(broker, "dev/value"), (std::vector<std::string>{ "4" }));
+}
+
+TEST_F(PublishInterval, PublishesUnchangedValuesAfterTheMaximumInterval) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  auto& value = client.add<int>("value", 7);
+  value.setPublishInterval(0, 1000);
+  connect(client);
+  PubSubClient& broker = client;
+  broker.clearRecorded();
+
+  run(client, 1000 - 2 * SIMPLEMQTT_TIMER_RESOLUTION);
+  EXPECT_TRUE(payloads(broker, "dev/value").empty());
+  run(client, 3 * SIMPLEMQTT_TIMER_RESOLUTION);
+  EXPECT_EQ(payloads(broker, "dev/value"), (std::vector<std::string>{ "7" }));
+  run(client, 1000 + SIMPLEMQTT_TIMER_RESOLUTION);
+  EXPECT_EQ(payloads(broker, "dev/value"), (std::vector<std::string>{ "7", "7" }));
+
+  // a publish in between restarts the interval
+  run(client, 500);
+  value = 8;
+  client.handle();
+  EXPECT_EQ(payloads(broker, "dev/value").size(), 3u);
+  run(client, 1000 - 2 * SIMPLEMQTT_TIMER_RESOLUTION);
+  EXPECT_EQ(payloads(broker, "dev/value").size(), 3u);
+  run(client, 3 * SIMPLEMQTT_TIMER_RESOLUTION);
+  EXPECT_EQ(payloads(broker, "dev/value"), (std::vector<std::string>{ "7", "7", "8", "8" }));
+}
+
+TEST_F(PublishInterval, AnswersRequestsWithinTheMinimumInterval) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  auto& value = client.add<int>("value", 5);
+  value.setPublishInterval(10000, 0);
+  connect(client);
+  PubSubClient& broker = client;
+  broker.clearRecorded();
+
+  run(client, 500);
+  broker.deliver(client.getFinalTopic(value.getRequestTopic()).c_str(), "");
+  client.handle();
+  EXPECT_EQ(payloads(broker, "dev/value"), (std::vector<std::string>{ "5" }));
+}
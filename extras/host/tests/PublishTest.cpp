@@ -0,0 +1,216 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host tests: publishing of topics
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// Publishes topics to the memory PubSubClient and checks what has been sent and which
+// state the topics are left in.
+
+#include <gtest/gtest.h>
+#include <SimpleMQTT.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+
+  template <typename C>
+  void connect(C& client) {
+    for (int i = 0; i < 10; i++)
+      client.handle();
+  }
+
+  // Returns a longer payload on each call.
+  int growingCalls = 0;
+  String growing() {
+    growingCalls++;
+    return String(std::string(SIMPLEMQTT_PUBLISH_BUFFER + growingCalls, 'x').c_str());
+  }
+
+  std::vector<std::string> payloads(PubSubClient& broker, const std::string& topic) {
+    std::vector<std::string> result;
+    for (const PubSubClient::Message& m : broker.published)
+      if (m.topic == topic)
+        result.push_back(m.payload);
+    return result;
+  }
+
+}  // namespace
+
+TEST(Publish, FormatsLongPayloadsOnce) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  client.add("f", growing);
+  connect(client);
+  PubSubClient& broker = client;
+
+  size_t published = 0;
+  for (const PubSubClient::Message& m : broker.published) {
+    if (m.topic != "dev/f")
+      continue;
+    published++;
+    EXPECT_GT(m.payload.size(), (size_t)SIMPLEMQTT_PUBLISH_BUFFER);
+    EXPECT_EQ(m.payload, std::string(m.payload.size(), 'x'));
+  }
+  EXPECT_GT(published, 0u);
+  // the announced length matches the payload that has been written
+  EXPECT_EQ(broker.lengthMismatches, 0u);
+}
+
+TEST(Publish, UsesProgmemNamesOfDeepTrees) {
+  // more levels than the PROGMEM name cache has slots
+  Topic_P(n1, "n1");
+  Topic_P(n2, "n2");
+  Topic_P(n3, "n3");
+  Topic_P(n4, "n4");
+  Topic_P(n5, "n5");
+  Topic_P(n6, "n6");
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  int value = 1;
+  MQTTTopic& topic = client.add(n1).add(n2).add(n3).add(n4).add(n5).add(n6, &value);
+  EXPECT_STREQ(topic.getFullTopic(TopicOrder::TOP_DOWN).c_str(), "dev/n1/n2/n3/n4/n5/n6");
+  EXPECT_STREQ(topic.getFullTopic(TopicOrder::BOTTOM_UP).c_str(), "n6/n5/n4/n3/n2/n1/dev");
+  connect(client);
+  PubSubClient& broker = client;
+
+  ASSERT_FALSE(broker.published.empty());
+  EXPECT_EQ(broker.published.back().topic, "dev/n1/n2/n3/n4/n5/n6");
+}
+
+TEST(Publish, RetriesFailedPublishes) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  int a = 1;
+  MQTTTopic& topic = client.add("group").add("a", &a);
+  connect(client);
+  PubSubClient& broker = client;
+
+  broker.failPublishes = true;
+  a = 2;
+  connect(client);
+  EXPECT_TRUE(topic.needsPublish());
+  broker.failPublishes = false;
+  broker.clearRecorded();
+  connect(client);
+  EXPECT_FALSE(topic.needsPublish());
+  ASSERT_FALSE(broker.published.empty());
+  EXPECT_EQ(broker.published.back().topic, "dev/group/a");
+  EXPECT_EQ(broker.published.back().payload, "2");
+}
+
+TEST(Publish, ComparesNaNAndInfinities) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  float f = 0;
+  client.add("f", &f).setPublishPolicy(PublishPolicy::RELATIVE_DEADBAND, 0.1);
+  connect(client);
+  PubSubClient& broker = client;
+  broker.clearRecorded();
+
+  f = INFINITY;
+  connect(client);
+  connect(client);
+  f = 5;
+  connect(client);
+  f = NAN;
+  connect(client);
+  connect(client);
+  f = -INFINITY;
+  connect(client);
+  // dtostrf() pads the names to the width of "-inf"
+  EXPECT_EQ(payloads(broker, "dev/f"), (std::vector<std::string>{ " inf", "5.00", " nan", "-inf" }));
+}
+
+TEST(Publish, KeepsThePublishedValueOfFailedPublishes) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  client.setReconnectDelay(0, 0);
+  float f = 0;
+  client.add("f", &f).setPublishPolicy(PublishPolicy::ABSOLUTE_DEADBAND, 1.5);
+  connect(client);
+  PubSubClient& broker = client;
+  broker.clearRecorded();
+
+  // the publishes after the reconnect fail
+  broker.dropConnection();
+  f = 1;
+  broker.failPublishes = true;
+  connect(client);
+  broker.failPublishes = false;
+  // the change is compared with the last value that has actually been published
+  f = 2;
+  connect(client);
+  EXPECT_EQ(payloads(broker, "dev/f"), (std::vector<std::string>{ "2.00" }));
+}
+
+TEST(Publish, KeepsSettingsThatShareTheirMemory) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  int32_t v = 0;
+  auto& topic = client.add("v", &v);
+  EXPECT_EQ(topic.getPublishPolicy(), PublishPolicy::ALWAYS);
+  EXPECT_EQ(topic.getCheckInterval(), 0u);
+  // the settings are made in an order that allocates their memory before the publish policy is set
+  topic.setPayloadCache(true);
+  topic.setCheckInterval(1);
+  topic.setPublishPolicy(PublishPolicy::ABSOLUTE_DEADBAND, 5);
+  topic.setPayloadCache(false);
+  topic.setCheckInterval(0);
+  EXPECT_EQ(topic.getPublishPolicy(), PublishPolicy::ABSOLUTE_DEADBAND);
+  EXPECT_EQ(topic.getCheckInterval(), 0u);
+  connect(client);
+  PubSubClient& broker = client;
+  broker.clearRecorded();
+
+  v = 3;
+  connect(client);
+  v = 10;
+  connect(client);
+  topic.setPayloadCache(true);
+  v = 12;
+  connect(client);
+  v = 20;
+  connect(client);
+  EXPECT_EQ(payloads(broker, "dev/v"), (std::vector<std::string>{ "10", "20" }));
+}
+
+TEST(Publish, AnswersGroupRequestsWithAllSubtopics) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  int a = 1, b = 2;
+  MQTTGroup& group = client.add("group");
+  group.add("a", &a).setSuppressDuplicates(true);
+  group.add("sub").add("b", &b).setSuppressDuplicates(true);
+  connect(client);
+  PubSubClient& broker = client;
+  broker.clearRecorded();
+
+  broker.deliver(client.getFinalTopic(group.getRequestTopic()).c_str(), "");
+  connect(client);
+  EXPECT_EQ(payloads(broker, "dev/group/a"), (std::vector<std::string>{ "1" }));
+  EXPECT_EQ(payloads(broker, "dev/group/sub/b"), (std::vector<std::string>{ "2" }));
+}
+
+TEST(Publish, DetectsChangesOfWatchedVariables) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  static int values[8] = {};
+  MQTTGroup& group = client.add("watched").setWatched(true);
+  // added in the reverse order of their addresses
+  for (int i = 7; i >= 0; i--)
+    group.add(String(i), &values[i]);
+  connect(client);
+  PubSubClient& broker = client;
+  broker.clearRecorded();
+
+  values[0] = 10;
+  values[5] = 15;
+  connect(client);
+  EXPECT_EQ(payloads(broker, "dev/watched/0"), (std::vector<std::string>{ "10" }));
+  EXPECT_EQ(payloads(broker, "dev/watched/5"), (std::vector<std::string>{ "15" }));
+  EXPECT_EQ(broker.published.size(), 2u);
+}
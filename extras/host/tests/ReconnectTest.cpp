@@ -0,0 +1,184 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host tests: connect attempts and reconnects
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// The broker of the memory PubSubClient is made unavailable to let connect attempts fail.
+// The tests run on the manual clock of the Arduino stand-in.
+
+#include <gtest/gtest.h>
+#include <SimpleMQTT.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+  template <typename C>
+  void connect(C& client) {
+    for (int i = 0; i < 10; i++)
+      client.handle();
+  }
+
+  std::vector<std::string> payloads(PubSubClient& broker, const std::string& topic) {
+    std::vector<std::string> result;
+    for (const PubSubClient::Message& m : broker.published)
+      if (m.topic == topic)
+        result.push_back(m.payload);
+    return result;
+  }
+
+  class Reconnect : public ::testing::Test {
+  protected:
+    NullClient network;
+    SimpleMQTTClient client{ network, "dev", "localhost" };
+    PubSubClient& broker = client;
+
+    void SetUp() override {
+      SimpleMQTTHost::setManualClock(true);
+    }
+
+    void TearDown() override {
+      SimpleMQTTHost::setManualClock(false);
+    }
+
+    // Waits until the next connect attempt is due and lets it fail.
+    // Returns the time waited in milliseconds.
+    uint32_t failAttempt() {
+      uint32_t wait = client.getReconnectWait();
+      if (wait > 1) {
+        // no attempt before the delay has passed
+        uint16_t failed = client.getFailedConnects();
+        SimpleMQTTHost::advanceMillis(wait - 1);
+        client.handle();
+        EXPECT_EQ(client.getFailedConnects(), failed);
+        SimpleMQTTHost::advanceMillis(1);
+      } else
+        SimpleMQTTHost::advanceMillis(wait);
+      client.handle();
+      return wait;
+    }
+
+    // Loses the connection and connects again.
+    void reconnect() {
+      broker.dropConnection();
+      broker.clearRecorded();
+      connect(client);
+      EXPECT_TRUE(client.connected());
+    }
+  };
+
+}  // namespace
+
+TEST_F(Reconnect, DoublesTheDelayAfterEachFailedAttempt) {
+  client.setReconnectDelay(1000, 8000);
+  broker.brokerAvailable = false;
+  EXPECT_EQ(client.getReconnectWait(), 0u);
+
+  failAttempt();
+  EXPECT_EQ(client.getFailedConnects(), 1);
+  // the delay is reduced by a random amount of up to half of it
+  const uint32_t delays[] = { 1000, 2000, 4000, 8000, 8000 };
+  for (uint32_t delay : delays) {
+    uint32_t wait = client.getReconnectWait();
+    EXPECT_LE(wait, delay);
+    EXPECT_GE(wait, delay / 2);
+    uint16_t failed = client.getFailedConnects();
+    EXPECT_EQ(failAttempt(), wait);
+    EXPECT_EQ(client.getFailedConnects(), failed + 1);
+  }
+}
+
+TEST_F(Reconnect, RestartsWithTheMinimumDelayAfterAConnect) {
+  client.setReconnectDelay(1000, 60000);
+  broker.brokerAvailable = false;
+  for (int i = 0; i < 4; i++)
+    failAttempt();
+  EXPECT_EQ(client.getFailedConnects(), 4);
+
+  broker.brokerAvailable = true;
+  failAttempt();
+  connect(client);
+  EXPECT_TRUE(client.connected());
+  EXPECT_EQ(client.getFailedConnects(), 0);
+  EXPECT_EQ(client.getReconnectWait(), 0u);
+
+  // the connection is lost; the first attempt is made immediately
+  broker.brokerAvailable = false;
+  broker.dropConnection();
+  client.handle();
+  client.handle();
+  EXPECT_EQ(client.getFailedConnects(), 1);
+  uint32_t wait = client.getReconnectWait();
+  EXPECT_LE(wait, 1000u);
+  EXPECT_GE(wait, 500u);
+}
+
+TEST_F(Reconnect, LimitsTheMaximumDelayToTheMinimumDelay) {
+  client.setReconnectDelay(2000, 100);
+  broker.brokerAvailable = false;
+  for (int i = 0; i < 5; i++) {
+    failAttempt();
+    uint32_t wait = client.getReconnectWait();
+    EXPECT_LE(wait, 2000u);
+    EXPECT_GE(wait, 1000u);
+  }
+}
+
+TEST_F(Reconnect, PublishesOnlyChangedTopicsAfterAReconnect) {
+  auto& retained = client.add<int>("retained", 1);
+  retained.setRetained(true);
+  int32_t other = 2;
+  client.add("other", &other);
+  connect(client);
+  EXPECT_EQ(payloads(broker, "dev/retained"), (std::vector<std::string>{ "1" }));
+
+  // the broker still has the retained payload
+  reconnect();
+  EXPECT_TRUE(payloads(broker, "dev/retained").empty());
+  EXPECT_TRUE(payloads(broker, "dev/other").empty());
+  // the subscriptions are renewed regardless
+  EXPECT_FALSE(broker.subscriptions.empty());
+
+  // a variable that has changed while disconnected is published
+  broker.brokerAvailable = false;
+  broker.dropConnection();
+  client.handle();
+  other = 3;
+  client.handle();
+  broker.brokerAvailable = true;
+  client.setReconnectDelay(0, 0);
+  SimpleMQTTHost::advanceMillis(client.getReconnectWait());
+  broker.clearRecorded();
+  connect(client);
+  EXPECT_TRUE(payloads(broker, "dev/retained").empty());
+  EXPECT_EQ(payloads(broker, "dev/other"), (std::vector<std::string>{ "3" }));
+}
+
+TEST_F(Reconnect, AnnouncesTopicsOfGroupsThatMustBeAnnounced) {
+  MQTTGroup& group = client.add("group");
+  group.setMustAnnounce(true);
+  group.add<int>("announced", 1);
+  auto& single = client.add<int>("single", 2);
+  single.setMustAnnounce(true);
+  client.add<int>("other", 3);
+  connect(client);
+
+  reconnect();
+  EXPECT_EQ(payloads(broker, "dev/group/announced"), (std::vector<std::string>{ "1" }));
+  EXPECT_EQ(payloads(broker, "dev/single"), (std::vector<std::string>{ "2" }));
+  EXPECT_TRUE(payloads(broker, "dev/other").empty());
+}
+
+TEST_F(Reconnect, PublishesAllTopicsWithFullResync) {
+  client.setFullResync(true);
+  client.add<int>("value", 1);
+  client.add("group").add<int>("value", 2);
+  connect(client);
+
+  reconnect();
+  EXPECT_EQ(payloads(broker, "dev/value"), (std::vector<std::string>{ "1" }));
+  EXPECT_EQ(payloads(broker, "dev/group/value"), (std::vector<std::string>{ "2" }));
+}
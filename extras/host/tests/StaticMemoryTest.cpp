@@ -0,0 +1,134 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host tests: running out of static memory
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// Built with SIMPLEMQTT_STATIC_MEMORY_SIZE so that the tests can take away the free memory and check
+// how topics behave when their names cannot be cached.
+
+#include <gtest/gtest.h>
+#include <SimpleMQTT.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace SimpleMQTT::__internal;
+
+namespace {
+
+  // Takes all free blocks and the rest of the static memory. One block of each size class
+  // up to 512 bytes is taken first so that single blocks of these sizes can be released.
+  class HeldMemory {
+    std::vector<std::pair<void*, size_t>> blocks;
+
+    void take(uint8_t sizeClass) {
+      void* block = allocateBlock(memClassSize(sizeClass));
+      if (block != nullptr)
+        blocks.push_back({ block, memClassSize(sizeClass) });
+    }
+
+  public:
+    HeldMemory() {
+      for (uint8_t c = 0; c <= memClass(512); c++)
+        take(c);
+      for (int c = MEM_CLASSES - 1; c >= 0; c--) {
+        size_t count;
+        do {
+          count = blocks.size();
+          take((uint8_t)c);
+        } while (blocks.size() > count);
+      }
+    }
+
+    ~HeldMemory() {
+      clear();
+    }
+
+    // Returns one block of the size class of the given length to the pool.
+    void release(size_t length) {
+      for (size_t i = 0; i < blocks.size(); i++) {
+        if (memClass(blocks[i].second) == memClass(length)) {
+          deallocateBlock(blocks[i].first, blocks[i].second);
+          blocks.erase(blocks.begin() + i);
+          return;
+        }
+      }
+      FAIL() << "no block of " << length << " bytes held";
+    }
+
+    void clear() {
+      for (auto& block : blocks)
+        deallocateBlock(block.first, block.second);
+      blocks.clear();
+    }
+  };
+
+  // Invalidates all cached topic names and releases the arena they are stored in.
+  void releaseTopicNames() {
+    pathVersion++;
+    topicArena.reset();
+    topicArena.version = pathVersion;
+  }
+
+  // Each test starts with empty static memory; the topics of the previous tests are never released.
+  class StaticMemory : public ::testing::Test {
+  protected:
+    void SetUp() override {
+      topicArena.reset();
+      memPointer = 0;
+      for (MemoryPool& pool : memoryPools)
+        pool = MemoryPool();
+    }
+  };
+
+}  // namespace
+
+TEST_F(StaticMemory, DoesNotKeepPartiallyCachedNames) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  client.setTopicPattern(String(std::string(300, 'p').c_str()) + "/%s");
+  MQTTGroup& group = client.add("group");
+  auto& value = group.add<int32_t>("value", 0);
+  std::string full = value.fullTopicStr();
+  ASSERT_FALSE(full.empty());
+
+  releaseTopicNames();
+  HeldMemory held;
+  // room for the full name only; the final name does not fit into a regular arena chunk
+  held.release(SIMPLEMQTT_TOPIC_ARENA_CHUNK);
+  EXPECT_STREQ(value.fullTopicStr(), "");
+  EXPECT_FALSE(topicArena.contains(full.c_str()));
+
+  // the failure is kept until the names change
+  held.clear();
+  EXPECT_STREQ(value.fullTopicStr(), "");
+  EXPECT_EQ(value.getFullTopic(), String(full.c_str()));
+  pathVersion++;
+  EXPECT_EQ(std::string(value.fullTopicStr()), full);
+}
+
+TEST_F(StaticMemory, DoesNotAddTopicsWhoseNameCannotBeCached) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  MQTTGroup& group = client.add("names");
+  using ValueType = std::remove_reference_t<decltype(group.add<int32_t>("x", 0))>;
+  ASSERT_NE(memClass(sizeof(ValueType)), memClass(SIMPLEMQTT_TOPIC_ARENA_CHUNK));
+
+  releaseTopicNames();
+  HeldMemory held;
+  // room for the topic object and the list of subtopics but not for the name
+  held.release(sizeof(ValueType));
+  held.release(2 * sizeof(MQTTTopic*));
+  auto& first = group.add<int32_t>("first", 0);
+  EXPECT_EQ((const void*)&first, INVALID_PTR);
+  EXPECT_EQ(group.size(), 0u);
+
+  held.clear();
+  pathVersion++;
+  auto& second = group.add<int32_t>("second", 0);
+  EXPECT_NE((const void*)&second, INVALID_PTR);
+  EXPECT_EQ(group.size(), 1u);
+}
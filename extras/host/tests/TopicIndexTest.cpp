@@ -0,0 +1,160 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT host tests: dispatch of incoming messages
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// Incoming messages are dispatched through the topic index. These tests make sure that the index
+// and the wildcard subscriptions use the same topic names as the individual subscriptions,
+// including overridden topic composition.
+
+#include <gtest/gtest.h>
+#include <SimpleMQTT.h>
+
+#include <algorithm>
+#include <string>
+
+namespace {
+
+  // Client that prefixes all topics and uses "/cmd" instead of "/set"
+  class PrefixClient : public SimpleMQTTClient {
+  public:
+    using SimpleMQTTClient::SimpleMQTTClient;
+
+    String getFinalTopic(const String& topic) override {
+      return "site/" + SimpleMQTTClient::getFinalTopic(topic);
+    };
+
+    String applySetPattern(MQTTTopic* value) override {
+      return value->getFullTopic(getTopicOrder()) + "/cmd";
+    };
+  };
+
+  template <typename C>
+  void connect(C& client) {
+    for (int i = 0; i < 10; i++)
+      client.handle();
+  }
+
+  bool subscribed(PubSubClient& broker, const std::string& topic) {
+    return std::find(broker.subscriptions.begin(), broker.subscriptions.end(), topic) != broker.subscriptions.end();
+  }
+
+}  // namespace
+
+TEST(TopicIndex, DispatchesSetAndRequest) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  int a = 0, b = 0;
+  MQTTGroup& group = client.add("group");
+  client.add("a", &a);
+  group.add("b", &b);
+  connect(client);
+  PubSubClient& broker = client;
+
+  broker.deliver("dev/a/set", "5");
+  broker.deliver("dev/group/b/set", "7");
+  EXPECT_EQ(a, 5);
+  EXPECT_EQ(b, 7);
+
+  // unknown topics and partial names are ignored
+  broker.deliver("dev/group/b/set/x", "8");
+  broker.deliver("dev/group/set", "8");
+  broker.deliver("dev/b/set", "8");
+  EXPECT_EQ(b, 7);
+}
+
+TEST(TopicIndex, UsesOverriddenTopicComposition) {
+  NullClient network;
+  PrefixClient client(network, "dev", "localhost");
+  int a = 0;
+  MQTTTopic& topic = client.add("a", &a);
+  connect(client);
+  PubSubClient& broker = client;
+
+  ASSERT_TRUE(subscribed(broker, "site/dev/a/cmd"));
+  broker.deliver("site/dev/a/cmd", "5");
+  EXPECT_EQ(a, 5);
+  broker.deliver("site/dev/a/set", "6");
+  broker.deliver("dev/a/cmd", "6");
+  EXPECT_EQ(a, 5);
+
+  std::string request = client.getFinalTopic(topic.getRequestTopic()).c_str();
+  ASSERT_TRUE(subscribed(broker, request));
+  broker.clearRecorded();
+  broker.deliver(request.c_str(), "");
+  client.handle();
+  ASSERT_FALSE(broker.published.empty());
+  EXPECT_EQ(broker.published.back().topic, "site/dev/a");
+  EXPECT_EQ(broker.published.back().payload, "5");
+}
+
+TEST(WildcardSubscriptions, CoverTheTopics) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  client.setWildcardSubscriptions(true);
+  int a = 0, b = 0, c = 0;
+  MQTTGroup& group = client.add("group");
+  group.add("a", &a);
+  group.add("b", &b);
+  client.add("/c", &c);
+  client.setRequestPattern("req/%s");
+  connect(client);
+  PubSubClient& broker = client;
+
+  EXPECT_TRUE(subscribed(broker, "dev/+/+/set"));
+  EXPECT_TRUE(subscribed(broker, "req/dev/+/+"));
+  EXPECT_FALSE(subscribed(broker, "dev/group/a/set"));
+  // top-level topics are subscribed individually
+  EXPECT_TRUE(subscribed(broker, "c"));
+  broker.deliver("dev/group/b/set", "3");
+  EXPECT_EQ(b, 3);
+}
+
+TEST(WildcardSubscriptions, UseOverriddenTopicComposition) {
+  NullClient network;
+  PrefixClient client(network, "dev", "localhost");
+  client.setWildcardSubscriptions(true);
+  int a = 0, b = 0, x = 0;
+  MQTTGroup& group = client.add("group");
+  group.add("a", &a);
+  group.add("b", &b);
+  client.add("x", &x);
+  connect(client);
+  PubSubClient& broker = client;
+
+  // the set pattern of the client applies to its children only
+  EXPECT_TRUE(subscribed(broker, "site/dev/+/cmd"));
+  EXPECT_TRUE(subscribed(broker, "site/dev/+/+/set"));
+  EXPECT_TRUE(subscribed(broker, "site/dev/+/+/get"));
+  for (const std::string& s : broker.subscriptions)
+    EXPECT_EQ(s.compare(0, 5, "site/"), 0) << s;
+  broker.deliver("site/dev/group/a/set", "4");
+  broker.deliver("site/dev/x/cmd", "5");
+  EXPECT_EQ(a, 4);
+  EXPECT_EQ(x, 5);
+}
+
+TEST(TopicIndex, ParsesBooleansIgnoringCase) {
+  NullClient network;
+  SimpleMQTTClient client(network, "dev", "localhost");
+  auto& b = client.add<bool>("b");
+  connect(client);
+  PubSubClient& broker = client;
+
+  broker.deliver("dev/b/set", "TRUE");
+  EXPECT_TRUE(b.value());
+  broker.deliver("dev/b/set", "Off");
+  EXPECT_FALSE(b.value());
+  broker.deliver("dev/b/set", "Toggle");
+  EXPECT_TRUE(b.value());
+  broker.deliver("dev/b/set", "toggle");
+  EXPECT_FALSE(b.value());
+  // only complete words are accepted
+  broker.deliver("dev/b/set", "yess");
+  broker.deliver("dev/b/set", "ye");
+  EXPECT_FALSE(b.value());
+  broker.deliver("dev/b/set", "Yes");
+  EXPECT_TRUE(b.value());
+}
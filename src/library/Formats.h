@@ -21,6 +21,30 @@ enum class BoolFormat : uint8_t {
   ANY         // output like TRUEFALSE. Input may be one of the above.
 };
 
+// Format for floating point values. Holds a printf format string like "%.3f".
+// Format strings of the form "%.Nf" (N = 0..9) and "%f" are compiled to their number of decimals
+// which allows converting values without snprintf().
+struct FractionalFormat {
+  const char* format;
+  int8_t decimals;  // -1 if the format string cannot be compiled
+
+  FractionalFormat(const char* aFormat = nullptr) : format(aFormat), decimals(compile(aFormat)) {};
+
+  operator const char*() const {
+    return format;
+  };
+
+  static int8_t compile(const char* format) {
+    if (format == nullptr || format[0] != '%')
+      return -1;
+    if (format[1] == 'f' && format[2] == '\0')
+      return 6;
+    if (format[1] == '.' && format[2] >= '0' && format[2] <= '9' && format[3] == 'f' && format[4] == '\0')
+      return format[2] - '0';
+    return -1;
+  };
+};
+
 // global default presets
 static BoolFormat DEFAULT_BOOL_FORMAT = BoolFormat::ANY;
 static IntegralFormat DEFAULT_INTEGRAL_FORMAT = IntegralFormat::DECIMAL;
@@ -35,9 +59,9 @@ struct format_type { typedef NoFormat type; };
 template<typename T>
 struct format_type<T, typename std::enable_if<std::is_integral<T>::value>::type> { typedef IntegralFormat type; };
 
-// format type template for floating point types (char*)
+// format type template for floating point types (format string)
 template<typename T>
-struct format_type<T, typename std::enable_if<std::is_floating_point<T>::value>::type> { typedef const char* type; };
+struct format_type<T, typename std::enable_if<std::is_floating_point<T>::value>::type> { typedef FractionalFormat type; };
 
 // format type template for bool type
 template<>
@@ -82,59 +106,252 @@ namespace __internal {
     return boolToString(value, format);
   }
 
+  // integral conversion kernels; they work on buffers supplied by the caller and support all integral types up to 64 bits
+
+  // Maximum number of characters of a formatted integral value (64 bit octal value with sign).
+  static const size_t INTEGRAL_CHARS = 23;
+
+  template <uint8_t Base, typename U>
+  size_t digitsToChars(char* buffer, U magnitude) {
+    // a constant base allows the compiler to replace the division by a multiplication
+    char digits[INTEGRAL_CHARS];
+    size_t n = 0;
+    do {
+      digits[n++] = "0123456789abcdef"[magnitude % Base];
+      magnitude /= Base;
+    } while (magnitude != 0);
+    for (size_t i = 0; i < n; i++)
+      buffer[i] = digits[n - 1 - i];
+    return n;
+  }
+
+  template <uint8_t Base, typename U>
+  size_t magnitudeToChars(char* buffer, U magnitude) {
+    // use 32 bit arithmetic for 64 bit values where possible
+    if constexpr (sizeof(U) > sizeof(uint32_t)) {
+      if (magnitude <= 0xFFFFFFFFu)
+        return digitsToChars<Base>(buffer, (uint32_t)magnitude);
+    }
+    return digitsToChars<Base>(buffer, magnitude);
+  }
+
+  // Writes the value in the given base to the buffer which must hold at least INTEGRAL_CHARS characters.
+  // Negative values are written as a minus sign followed by their magnitude in all bases.
+  // Does not append a terminating zero. Returns the number of characters written.
+  template <typename T>
+  size_t integralToChars(char* buffer, T value, IntegralFormat format) {
+    typedef typename std::make_unsigned<std::remove_cv_t<T>>::type U;
+    U magnitude = (U)value;
+    size_t n = 0;
+    if constexpr (std::is_signed_v<T>) {
+      if (value < 0) {
+        buffer[n++] = '-';
+        magnitude = (U)0 - magnitude;
+      }
+    }
+    switch (format) {
+      case IntegralFormat::OCTAL: return n + magnitudeToChars<8>(buffer + n, magnitude);
+      case IntegralFormat::HEXADECIMAL: return n + magnitudeToChars<16>(buffer + n, magnitude);
+      default: return n + magnitudeToChars<10>(buffer + n, magnitude);
+    }
+  }
+
+  // Parses an integral value in the given base. Accepts leading whitespace, a sign and, for hexadecimal values, a "0x" prefix.
+  // Returns false if there are no digits, if there are invalid characters or if the value does not fit into T.
+  template <typename T>
+  bool integralFromChars(std::string_view str, T* valptr, IntegralFormat format) {
+    typedef typename std::make_unsigned<T>::type U;
+    uint8_t base = (uint8_t)format;
+    const char* s = str.data();
+    const char* end = s + str.length();
+    while (s < end && isspace(*s))
+      s++;
+    bool negative = false;
+    if (s < end && (*s == '+' || *s == '-'))
+      negative = (*s++ == '-');
+    if (base == 16 && end - s > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X') && isxdigit(s[2]))
+      s += 2;
+    // largest magnitude that fits into T
+    U limit = (U)~(U)0;
+    if constexpr (std::is_signed_v<T>)
+      limit = (negative ? (U)(limit / 2 + 1) : (U)(limit / 2));
+    else if (negative)
+      limit = 0;
+    U magnitude = 0;
+    const char* digits = s;
+    for (; s < end; s++) {
+      uint8_t digit;
+      if (*s >= '0' && *s <= '9')
+        digit = *s - '0';
+      else if (*s >= 'a' && *s <= 'f')
+        digit = *s - 'a' + 10;
+      else if (*s >= 'A' && *s <= 'F')
+        digit = *s - 'A' + 10;
+      else
+        return false;
+      if (digit >= base)
+        return false;
+      // overflow check
+      if (digit > limit || magnitude > (U)(limit - digit) / base)
+        return false;
+      magnitude = magnitude * base + digit;
+    }
+    if (s == digits)
+      return false;
+    *valptr = (T)(negative ? (U)0 - magnitude : magnitude);
+    return true;
+  }
+
   template <typename T>
   String formatValue(T value, IntegralFormat format) { 
-    return String(value, (uint8_t)format); // == IntegralFormat::DEFAULT_INTFORMAT ? IntegralFormat::DECIMAL : format));
+    char buffer[INTEGRAL_CHARS + 1];
+    buffer[integralToChars(buffer, value, format)] = '\0';
+    return String(buffer);
   }
-/*
-  template <>
-  String formatValue(int64_t value, IntegralFormat) {
-    // String does not support 64 bit value formatting (crash)
-    return String(value);
+
+  // fixed precision conversion of floating point values
+
+  static const uint32_t POWERS_OF_TEN[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+  // Rounds the absolute value of v to the given number of decimals and returns it scaled by 10^decimals.
+  // Returns false if the result might differ from the one of snprintf(), i. e. if the value is too large
+  // or too close to a tie between two decimals.
+  bool roundDecimals(double v, int8_t decimals, uint64_t* result) {
+    double scaled = fabs(v) * POWERS_OF_TEN[decimals];
+    // the integral part must be exactly representable; also rejects NaN and infinity
+    if (!(scaled < 4.5e15))
+      return false;
+    uint64_t q = (uint64_t)scaled;
+    double fraction = scaled - (double)q;
+    // the multiplication may be off by half a unit in the last place
+    if (fabs(fraction - 0.5) <= scaled * 2.3e-16)
+      return false;
+    *result = q + (fraction > 0.5 ? 1 : 0);
+    return true;
   }
 
-  template <>
-  String formatValue(uint64_t value, IntegralFormat) { 
-    // String does not support 64 bit value formatting (crash)
-    return String(value);
+  // Writes v with the given number of decimals like snprintf() with "%.Nf". The buffer must hold at least
+  // 32 characters. Does not append a terminating zero. Returns the number of characters written
+  // or 0 if the value has to be formatted by snprintf().
+  size_t fixedToChars(char* buffer, double v, int8_t decimals) {
+    uint64_t q;
+    if (decimals < 0 || !roundDecimals(v, decimals, &q))
+      return 0;
+    size_t n = 0;
+    if (std::signbit(v))
+      buffer[n++] = '-';
+    uint32_t scale = POWERS_OF_TEN[decimals];
+    n += integralToChars(buffer + n, q / scale, IntegralFormat::DECIMAL);
+    if (decimals > 0) {
+      buffer[n++] = '.';
+      uint32_t fraction = q % scale;
+      for (int8_t i = decimals - 1; i >= 0; i--) {
+        buffer[n + i] = '0' + fraction % 10;
+        fraction /= 10;
+      }
+      n += decimals;
+    }
+    return n;
   }
-*/
+
   template <typename T>
-  String formatValue(T value, const char* format) { 
-    if (format == nullptr)
+  String formatValue(T value, FractionalFormat format) { 
+    if (format.format == nullptr)
       return String(value);
     char buffer[SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER];
-    snprintf(buffer, SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER, format, value);
+    size_t n = fixedToChars(buffer, value, format.decimals);
+    if (n > 0)
+      buffer[n] = '\0';
+    else
+      snprintf(buffer, SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER, format.format, value);
     return String(buffer);
   }
 
+  // print functions; write the formatted value to a Print object without creating a String
+
+  size_t printBool(Print& p, bool b, BoolFormat format) {
+    switch (format) {
+      case BoolFormat::ANY:
+      case BoolFormat::TRUEFALSE: return p.print(b ? F("true") : F("false"));
+      case BoolFormat::YESNO: return p.print(b ? F("yes") : F("no"));
+      case BoolFormat::ONOFF: return p.print(b ? F("on") : F("off"));
+      case BoolFormat::ONEZERO: return p.print(b ? F("1") : F("0"));
+    }
+    return 0;
+  }
+
+  template <typename T, typename Format = NoFormat>
+  size_t printValue(Print& p, const T& value, Format format) {
+    if constexpr (std::is_same_v<std::remove_cv_t<T>, String> || std::is_same_v<std::remove_cv_t<T>, char*> || std::is_same_v<std::remove_cv_t<T>, const char*>)
+      return p.print(value);
+    else
+      return p.print(formatValue(value, format));
+  }
+
+  size_t printValue(Print& p, const bool& value, BoolFormat format) {
+    return printBool(p, value, format);
+  }
+
+  template <typename T>
+  size_t printValue(Print& p, const T& value, IntegralFormat format) {
+    char buffer[INTEGRAL_CHARS];
+    return p.write((const uint8_t*)buffer, integralToChars(buffer, value, format));
+  }
+
+  template <typename T>
+  size_t printValue(Print& p, const T& value, FractionalFormat format) {
+    char buffer[SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER];
+    if (format.format == nullptr) {
+      // same output as String(value); very large values and NaN do not fit into the buffer
+      if (!(value > -1e30 && value < 1e30))
+        return p.print(String(value));
+      dtostrf(value, 4, 2, buffer);
+    } else {
+      size_t n = fixedToChars(buffer, value, format.decimals);
+      if (n > 0)
+        return p.write((const uint8_t*)buffer, n);
+      snprintf(buffer, SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER, format.format, value);
+    }
+    return p.print(buffer);
+  }
+
 // parse functions
 
-  bool parseBool(const char* str, bool* b, BoolFormat format) {
+  // Returns whether the payload equals the PROGMEM string, ignoring the case of letters.
+  bool equalsIgnoreCase_P(std::string_view payload, const char* str) {
+    for (char c : payload) {
+      char expected = (char)pgm_read_byte(str++);
+      if (expected == '\0' || tolower((unsigned char)c) != tolower((unsigned char)expected))
+        return false;
+    }
+    return pgm_read_byte(str) == '\0';
+  }
+
+  bool parseBool(std::string_view str, bool* b, BoolFormat format) {
     *b = false;
     switch (format) {
       case BoolFormat::TRUEFALSE:
-        if (strcmp_P(str, PSTR("true")) == 0)
+        if (equalsIgnoreCase_P(str, PSTR("true")))
           *b = true;
-        else if (strcmp_P(str, PSTR("false")) != 0)
+        else if (!equalsIgnoreCase_P(str, PSTR("false")))
           return false;
         return true;
       case BoolFormat::YESNO:
-        if (strcmp_P(str, PSTR("yes")) == 0)
+        if (equalsIgnoreCase_P(str, PSTR("yes")))
           *b = true;
-        else if (strcmp_P(str, PSTR("no")) != 0)
+        else if (!equalsIgnoreCase_P(str, PSTR("no")))
           return false;
         return true;
       case BoolFormat::ONOFF:
-        if (strcmp_P(str, PSTR("on")) == 0)
+        if (equalsIgnoreCase_P(str, PSTR("on")))
           *b = true;
-        else if (strcmp_P(str, PSTR("off")) != 0)
+        else if (!equalsIgnoreCase_P(str, PSTR("off")))
           return false;
         return true;
       case BoolFormat::ONEZERO:
-        if (strcmp_P(str, PSTR("1")) == 0)
+        if (equalsIgnoreCase_P(str, PSTR("1")))
           *b = true;
-        else if (strcmp_P(str, PSTR("0")) != 0)
+        else if (!equalsIgnoreCase_P(str, PSTR("0")))
           return false;
         return true;
       case BoolFormat::ANY:
@@ -147,79 +364,66 @@ namespace __internal {
     return false;
   }
 
-  template<typename T, typename Format = typename format_type<T>::type>
-  bool parseIntegralType(const char* s, T* valptr, Format format) {
-    if constexpr (std::is_const_v<T>)
-      return false;
-    if (*s == '\0')
-      return false;
-    char* endptr;
-    int64_t v = strtoll(s, &endptr, (uint8_t)format);
-    if (*endptr != '\0')
-      return false;
-    T value = (T)v;
-    if (value != v)
-      return false;
-    if constexpr (!std::is_const_v<T>)
-      *valptr = (T)v;
-    else
-      return false;
-    return true;
+  // Assigns a payload to a String, reusing the capacity of the String.
+  void assignPayload(String& s, std::string_view payload) {
+    s.remove(0);
+    s.reserve(payload.length());
+    for (char c : payload)
+      s += c;
   }
 
-  // range checking templates for 64 bit types
-  template<>
-  bool parseIntegralType(const char* s, uint64_t* valptr, IntegralFormat format) {
-    if (*s == '\0')
-      return false;
-    char* endptr;
-    uint64_t v = strtoull(s, &endptr, (uint8_t)format);
-    if (*endptr != '\0')
-      return false;
-    // compare with string
-    String f = formatValue(v, format);
-    if (f != s)
-      return false;
-    *valptr = v;
-    return true;
+  // Returns whether the String contains exactly the characters of the payload.
+  bool equalsPayload(const String& s, std::string_view payload) {
+    return s.length() == payload.length() && memcmp(s.c_str(), payload.data(), payload.length()) == 0;
   }
 
-  template<>
-  bool parseIntegralType(const char* s, int64_t* valptr, IntegralFormat format) {
-    if (*s == '\0')
-      return false;
-    char* endptr;
-    int64_t v = strtoll(s, &endptr, (uint8_t)format);
-    if (*endptr != '\0')
-      return false;
-    // compare with string
-    String f = formatValue(v, format);
-    if (f != s)
+  // Copies a payload into a String for functions that require a terminated string.
+  String payloadToString(std::string_view payload) {
+    String result;
+    assignPayload(result, payload);
+    return result;
+  }
+
+  template<typename T, typename Format = typename format_type<T>::type>
+  bool parseIntegralType(std::string_view s, T* valptr, Format format) {
+    if constexpr (std::is_const_v<T>)
       return false;
-    *valptr = v;
-    return true;
+    else
+      return integralFromChars(s, valptr, format);
   }
 
   template<typename T, typename Format = typename format_type<T>::type>
-  bool parseFractionalType(const char* s, T* valptr, Format format) {
+  bool parseFractionalType(std::string_view s, T* valptr, Format format) {
     if constexpr (std::is_const_v<T>)
       return false;
-    if (*s == '\0')
+    if (s.empty())
+      return false;
+    // strtod() requires a terminated string
+    char buffer[SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER];
+    if (s.length() >= SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER)
       return false;
+    memcpy(buffer, s.data(), s.length());
+    buffer[s.length()] = '\0';
     char* endptr;
-    double v = strtod(s, &endptr);
+    double v = strtod(buffer, &endptr);
     if (*endptr != '\0')
       return false;
     // no range check here (double != float for most cases)
-    if (format != nullptr && format[0] != '\0') {
-      // apply strict decimal conversion by converting to string and back
-      String str;
-      char buffer[SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER];
-      snprintf(buffer, SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER, format, v);
-      str += buffer;
-      v = strtod(str.c_str(), &endptr);
-      if (*endptr != '\0')
-        return false;
+    if (format.format != nullptr && format.format[0] != '\0') {
+      // apply strict decimal conversion
+      uint64_t q;
+      if (format.decimals >= 0 && roundDecimals(v, format.decimals, &q)) {
+        // the quotient is correctly rounded, just like the result of strtod()
+        double rounded = (double)q / POWERS_OF_TEN[format.decimals];
+        v = (std::signbit(v) ? -rounded : rounded);
+      } else {
+        // convert to string and back; values whose text does not fit into the buffer are too large to have decimals
+        if (snprintf(buffer, SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER, format.format, v) < SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER) {
+          v = strtod(buffer, &endptr);
+          if (*endptr != '\0')
+            return false;
+        }
+      }
     }
     if constexpr (!std::is_const_v<T>)
       *valptr = (T)v;
@@ -229,42 +433,39 @@ namespace __internal {
   }
 
   template <typename T, typename Format = typename format_type<T>::type> 
-  typename std::enable_if<std::is_integral<T>::value, bool>::type parseValue(const char* str, T* value, Format format) { 
+  typename std::enable_if<std::is_integral<T>::value, bool>::type parseValue(std::string_view str, T* value, Format format) { 
     return parseIntegralType<T>(str, value, format);
   }
 
   template <typename T, typename Format = typename format_type<T>::type>
-  typename std::enable_if<std::is_floating_point<T>::value, bool>::type parseValue(const char* str, T* value, Format format) { 
+  typename std::enable_if<std::is_floating_point<T>::value, bool>::type parseValue(std::string_view str, T* value, Format format) { 
     return parseFractionalType<T>(str, value, format);
   }
 
-  bool parseValue(const char* str, bool* value, BoolFormat format) {
-    String s(str);
-    s.toLowerCase();
-    if (s == "toggle") {
+  bool parseValue(std::string_view str, bool* value, BoolFormat format) {
+    if (equalsIgnoreCase_P(str, PSTR("toggle"))) {
       *value = !*value;
       return true;
     }
-    return parseBool(s.c_str(), value, format);
+    return parseBool(str, value, format);
   }
 
-  bool parseValue(const char* str, String* value, NoFormat) { 
-    *value = String(str);
+  bool parseValue(std::string_view str, String* value, NoFormat) { 
+    assignPayload(*value, str);
     return true;
   }
   
-  bool parseValue(const char* str, const String* value, NoFormat) { 
+  bool parseValue(std::string_view, const String*, NoFormat) { 
     return false;
   }
   
-  bool parseValue(const char* str, char** value, NoFormat) { 
-    *value = (char*)str;
-    return true;
+  // the payload does not outlive the processing of the message and cannot be referenced
+  bool parseValue(std::string_view, char**, NoFormat) { 
+    return false;
   }
   
-  bool parseValue(const char* str, const char** value, NoFormat) { 
-    *value = str;
-    return true;
+  bool parseValue(std::string_view, const char**, NoFormat) { 
+    return false;
   }
   
 } // namespace __internal
@@ -17,8 +17,107 @@ SimpleMQTTClient* MQTTTopic::getClient() {
 
 void MQTTTopic::publish(bool) {
   SIMPLEMQTT_CHECK_VALID();
-  getClient()->publish(this);
+  SimpleMQTTClient* client = getClient();
+  if (!client->publish(this)) {
+    // keep the flags to retry; the publish pass has already cleared the flags of the groups
+    if (needsPublish())
+      requestPublish();
+    return;
+  }
   config &= PUBLISH_CLEARMASK;
+  requested = false;
+  __internal::PublishTimer* timer = publishTimer();
+  if (timer != nullptr)
+    client->restartPublishTimer(timer);
+  payloadPublished();
+}
+
+void MQTTTopic::republish() {
+  SIMPLEMQTT_CHECK_VALID();
+  // wait for the minimum publish interval; the publish is requested when the timer expires
+  __internal::PublishTimer* timer = publishTimer();
+  if (timer != nullptr && (config & PUBLISH_SETMASK) == 0 && getClient()->deferPublish(timer))
+    return;
+  requestPublish();
+}
+
+void MQTTTopic::requestPublish() {
+  // set flag to re-publish
+  config |= PUBLISH_SETMASK;
+  // mark the groups up to the client so that the publish pass descends into this subtree
+  MQTTGroup* group = _parent;
+  while (group != nullptr && (group->config & PUBLISH_SETMASK) == 0) {
+    group->config |= PUBLISH_SETMASK;
+    group = group->_parent;
+  }
+}
+
+MQTTTopic& MQTTTopic::setPublishInterval(uint32_t minInterval, uint32_t maxInterval) {
+  SIMPLEMQTT_CHECK_VALID(*this);
+  applyPublishInterval(minInterval, maxInterval);
+  return *this;
+}
+
+void MQTTTopic::applyPublishInterval(uint32_t minInterval, uint32_t maxInterval) {
+  if (publishTimer() == nullptr && minInterval == 0 && maxInterval == 0)
+    return;
+  if (getOptions() == nullptr) {
+    SIMPLEMQTT_ERROR(PSTR("Not enough memory for publish timer, topic '%s'\n"), name());
+    return;
+  }
+  __internal::PublishTimer* timer = &options->publishTimer;
+  timer->topic = this;
+  SimpleMQTTClient* client = getClient();
+  client->timerWheel.cancel(timer);
+  // a deferred publish is not lost
+  if (timer->deferred)
+    requestPublish();
+  timer->deferred = false;
+  timer->minInterval = minInterval;
+  timer->maxInterval = maxInterval;
+  if (minInterval == 0 && maxInterval == 0)
+    // the time of the last publish is not kept up to date without intervals
+    timer->published = false;
+  else if (maxInterval > 0 && asGroup() == nullptr)
+    // groups are published through their subtopics which have their own timers
+    client->timerWheel.schedule(timer, (timer->published ? timer->lastPublish : millis()) + maxInterval);
+}
+
+MQTTTopic& MQTTTopic::setPayloadCache(bool enable) {
+  SIMPLEMQTT_CHECK_VALID(*this);
+  if (enable && getOptions() == nullptr) {
+    SIMPLEMQTT_ERROR(PSTR("Not enough memory for payload cache, topic '%s'\n"), name());
+    return *this;
+  }
+  if (options != nullptr) {
+    options->payloadCache.enabled = enable;
+    options->payloadCache.valid = false;
+    if (!enable)
+      options->payloadCache.payload = String();
+  }
+  return *this;
+}
+
+MQTTTopic& MQTTTopic::setCheckInterval(uint32_t interval) {
+  SIMPLEMQTT_CHECK_VALID(*this);
+  if (interval > 0 && getOptions() == nullptr) {
+    SIMPLEMQTT_ERROR(PSTR("Not enough memory for check interval, topic '%s'\n"), name());
+    return *this;
+  }
+  if (options != nullptr) {
+    options->checkTimer.interval = interval;
+    // the first check is due immediately
+    options->checkTimer.lastCheck = millis() - interval;
+  }
+  return *this;
+}
+
+void MQTTTopic::queueChange() {
+  SIMPLEMQTT_CHECK_VALID();
+  // ignore topics that are not part of a topic tree
+  if (_parent == nullptr || nextChange != nullptr)
+    return;
+  getClient()->queueChange(this);
 }
 
 String MQTTTopic::getTopicPattern() {
@@ -30,23 +129,72 @@ String MQTTTopic::getTopicPattern() {
 
 String MQTTTopic::getFullTopic(TopicOrder order) {
   SIMPLEMQTT_CHECK_VALID(String());
-  const char* myName = name();
+  // copy the name because name() may return a slot of the PROGMEM name cache that the parents reuse
+  String myName = name();
   if (myName[0] == '/' || _parent == nullptr)
-    return String(myName);
+    return myName;
   else if (_parent != nullptr) {
     switch (order) {
-      case TopicOrder::BOTTOM_UP: return String(myName) + "/" + _parent->getFullTopic(order);
+      case TopicOrder::BOTTOM_UP: return myName + "/" + _parent->getFullTopic(order);
       default: return _parent->getFullTopic(order) + "/" + myName;
     }
   } else
-    return String(myName);
+    return myName;
 }
 
 String MQTTTopic::getFullTopic() {
-  if (_parent == nullptr)
-    return getFullTopic(TopicOrder::UNSPECIFIED);
-  else
-    return getFullTopic(_parent->getTopicOrder());
+  SIMPLEMQTT_CHECK_VALID(String());
+  const char* fullTopic = fullTopicStr();
+  // compute the name if it could not be cached
+  if (fullTopic[0] == '\0')
+    return (_parent == nullptr ? getFullTopic(TopicOrder::UNSPECIFIED) : getFullTopic(_parent->getTopicOrder()));
+  return String(fullTopic);
+}
+
+void MQTTTopic::updateTopicCache() {
+  SIMPLEMQTT_CHECK_VALID();
+  __internal::StringArena& arena = __internal::topicArena;
+  // topic names have changed; all cached names are recomputed
+  if (arena.version != __internal::pathVersion) {
+    arena.reset();
+    arena.version = __internal::pathVersion;
+  }
+  cachedFullTopic = __internal::EMPTY;
+  cachedFinalTopic = __internal::EMPTY;
+  String fullTopic = (_parent == nullptr ? getFullTopic(TopicOrder::UNSPECIFIED) : getFullTopic(_parent->getTopicOrder()));
+  // apply default topic pattern for non-top-level topics
+  String finalTopic = fullTopic;
+  if (!fullTopic.startsWith("/")) {
+    finalTopic = getTopicPattern();
+    if (finalTopic == "")
+      finalTopic = DEFAULT_TOPIC_PATTERN;
+    finalTopic.replace("%s", fullTopic);
+  }
+  if (_parent != nullptr)
+    finalTopic = getClient()->getFinalTopic(finalTopic);
+  else if (finalTopic.startsWith("/"))
+    finalTopic = finalTopic.substring(1);
+
+  const char* full = arena.add(fullTopic.c_str(), fullTopic.length());
+  const char* final = full;
+  if (full != nullptr && finalTopic != fullTopic) {
+    if (fullTopic.length() > 0 && finalTopic == full + 1)
+      final = full + 1;
+    else {
+      final = arena.add(finalTopic.c_str(), finalTopic.length());
+      // do not keep the full name without the final name
+      if (final == nullptr)
+        arena.release(full);
+    }
+  }
+  // a failure is kept until the names change so that the names are not recomputed on every access
+  cachedVersion = __internal::pathVersion;
+  if (final == nullptr) {
+    SIMPLEMQTT_ERROR(PSTR("Unable to allocate memory for topic name '%s'\n"), finalTopic.c_str());
+    return;
+  }
+  cachedFullTopic = full;
+  cachedFinalTopic = final;
 }
 
 String MQTTTopic::getRequestTopic() {
@@ -67,82 +215,142 @@ void MQTTTopic::addSubscriptions(SimpleMQTTClient* client) {
       String request_topic = client->getFinalTopic(getRequestTopic());
       const char* topic = request_topic.c_str();
       SIMPLEMQTT_DEBUG(PSTR("Subscribing to request with topic '%s'\n"), topic);
-      client->subscribe(topic);
+      client->subscribeTopic(topic, this, __internal::TopicIndex::REQUEST);
     }
     if (isSettable()) {
-      String set_topic = client->getFinalTopic(getSetTopic());
-      const char* topic = set_topic.c_str();
+      String set_topic = getSetTopic();
+      String final_topic = client->getFinalTopic(set_topic);
+      const char* topic = final_topic.c_str();
       SIMPLEMQTT_DEBUG(PSTR("Subscribing to set with topic '%s'\n"), topic);
-      client->subscribe(topic);
+      client->subscribeTopic(topic, this, (set_topic.startsWith("/") ? __internal::TopicIndex::SET_DIRECT : __internal::TopicIndex::SET));
     }
   } else
     SIMPLEMQTT_DEBUG(PSTR("Not valid, skipping: '%s'\n"), getFullTopic().c_str());
 }
 
-bool MQTTTopic::processPayload(SimpleMQTTClient* client, const char* topic, const char* payload) {
-  SIMPLEMQTT_CHECK_VALID(false);
-  if (isRequestable()) {
-    // request topic received?
-    if (client->getFinalTopic(getRequestTopic()) == topic) {
-      SIMPLEMQTT_DEBUG(PSTR("Request for topic '%s' with payload '%s'\n"), topic, payload);
-      switch (ResultCode code = requestReceived(payload)) {
-        case ResultCode::OK:
-          client->setStatus((int8_t)code, String(topic));
-          break;
-        default:
-          client->setStatus((int8_t)code, String(topic), String(payload));
-      }
-      SIMPLEMQTT_DEBUG(PSTR("After request:%s"), " ");
-      #ifdef SIMPLEMQTT_DEBUG_SERIAL
-      printTo(SIMPLEMQTT_DEBUG_SERIAL);
-      #endif
-      return true;
-    }
+String MQTTTopic::getWildcardTopic(const char* topic, __internal::TopicIndex::Kind kind) {
+  SIMPLEMQTT_CHECK_VALID(String());
+  // top-level topics are subscribed individually
+  if (kind == __internal::TopicIndex::SET_DIRECT)
+    return String();
+  const char* fullTopic = fullTopicStr();
+  const char* root = getClient()->name();
+  size_t length = strlen(fullTopic);
+  size_t rootLength = strlen(root);
+  if (fullTopic[0] == '/' || root[0] == '/' || length <= rootLength)
+    return String();
+  // part of the full topic that is replaced by wildcards
+  size_t start, end;
+  if (parent().getTopicOrder() == TopicOrder::BOTTOM_UP) {
+    // levels precede the client's topic
+    start = 0;
+    end = length - rootLength;
+    if (fullTopic[end - 1] != '/' || strcmp(fullTopic + end, root) != 0)
+      return String();
+  } else {
+    // levels follow the client's topic
+    start = rootLength;
+    end = length;
+    if (fullTopic[rootLength] != '/' || strncmp(fullTopic, root, rootLength) != 0)
+      return String();
+  }
+  // locate the full topic in the final topic; the patterns and the client may have added levels around it
+  const char* pos = topic;
+  while ((pos = strstr(pos, fullTopic)) != nullptr) {
+    if ((pos == topic || pos[-1] == '/') && (pos[length] == '\0' || pos[length] == '/'))
+      break;
+    pos++;
   }
+  if (pos == nullptr)
+    return String();
+  String result = String(topic).substring(0, pos - topic + start);
+  result += __internal::wildcardLevels(pos + start, end - start);
+  result += pos + end;
+  return result;
+}
+
+void MQTTTopic::addToIndex(SimpleMQTTClient* client, __internal::TopicIndex& index) {
+  SIMPLEMQTT_CHECK_VALID();
+  if (!isTopicValid())
+    return;
+  if (isRequestable())
+    index.add(this, __internal::TopicIndex::REQUEST, client->getFinalTopic(getRequestTopic()));
   if (isSettable()) {
-    // set topic received?
-    if (client->getFinalTopic(getSetTopic()) == topic) {
-      SIMPLEMQTT_DEBUG(PSTR("Set for topic '%s' with payload '%s'\n"), topic, payload);
-      switch (ResultCode code = setReceived(payload)) {
-        case ResultCode::OK:
-          client->setStatus((int8_t)code, String(topic));
-          break;
-        default:
-          client->setStatus((int8_t)code, String(topic), String(payload));
-      }
-      SIMPLEMQTT_DEBUG(PSTR("After set:%s"), " ");
-      #ifdef SIMPLEMQTT_DEBUG_SERIAL
-      printTo(SIMPLEMQTT_DEBUG_SERIAL);
-      #endif
-      return true;
-    }
+    String set_topic = getSetTopic();
+    index.add(this, (set_topic.startsWith("/") ? __internal::TopicIndex::SET_DIRECT : __internal::TopicIndex::SET),
+      client->getFinalTopic(set_topic));
   }
+}
+
+bool MQTTTopic::processPayload(SimpleMQTTClient* client, const char* topic, std::string_view payload) {
+  SIMPLEMQTT_CHECK_VALID(false);
+  // request topic received?
+  if (isRequestable() && client->getFinalTopic(getRequestTopic()) == topic)
+    return processRequest(client, topic, payload);
+  // set topic received?
+  if (isSettable() && client->getFinalTopic(getSetTopic()) == topic)
+    return processSet(client, topic, payload);
   return false;
 }
 
+bool MQTTTopic::processRequest(SimpleMQTTClient* client, const char* topic, std::string_view payload) {
+  SIMPLEMQTT_CHECK_VALID(false);
+  SIMPLEMQTT_DEBUG(PSTR("Request for topic '%s' with payload '%.*s'\n"), topic, (int)payload.length(), payload.data());
+  switch (ResultCode code = requestReceived(payload)) {
+    case ResultCode::OK:
+      client->setStatus((int8_t)code, String(topic));
+      break;
+    default:
+      client->setStatus((int8_t)code, String(topic), __internal::payloadToString(payload));
+  }
+  SIMPLEMQTT_DEBUG(PSTR("After request:%s"), " ");
+  #ifdef SIMPLEMQTT_DEBUG_SERIAL
+  printTo(SIMPLEMQTT_DEBUG_SERIAL);
+  #endif
+  return true;
+}
+
+bool MQTTTopic::processSet(SimpleMQTTClient* client, const char* topic, std::string_view payload) {
+  SIMPLEMQTT_CHECK_VALID(false);
+  SIMPLEMQTT_DEBUG(PSTR("Set for topic '%s' with payload '%.*s'\n"), topic, (int)payload.length(), payload.data());
+  switch (ResultCode code = setReceived(payload)) {
+    case ResultCode::OK:
+      client->setStatus((int8_t)code, String(topic));
+      break;
+    default:
+      client->setStatus((int8_t)code, String(topic), __internal::payloadToString(payload));
+  }
+  SIMPLEMQTT_DEBUG(PSTR("After set:%s"), " ");
+  #ifdef SIMPLEMQTT_DEBUG_SERIAL
+  printTo(SIMPLEMQTT_DEBUG_SERIAL);
+  #endif
+  return true;
+}
+
 void MQTTGroup::addSubscriptions(SimpleMQTTClient* client) {
   SIMPLEMQTT_CHECK_VALID();
   MQTTTopic::addSubscriptions(client);
-  ListNode* node = &nodes;
-  while (node->next != nullptr) {
-    MQTTTopic* value = node->data;
-    value->addSubscriptions(client);
-    node = node->next;
-  }
+  for (uint16_t i = 0; i < childCount; i++)
+    children[i]->addSubscriptions(client);
+}
+
+void MQTTGroup::addToIndex(SimpleMQTTClient* client, __internal::TopicIndex& index) {
+  SIMPLEMQTT_CHECK_VALID();
+  MQTTTopic::addToIndex(client, index);
+  for (uint16_t i = 0; i < childCount; i++)
+    children[i]->addToIndex(client, index);
 }
 
-bool MQTTGroup::processPayload(SimpleMQTTClient* client, const char* topic, const char* payload) {
+bool MQTTGroup::processPayload(SimpleMQTTClient* client, const char* topic, std::string_view payload) {
   SIMPLEMQTT_CHECK_VALID(false);
   if (MQTTTopic::processPayload(client, topic, payload))
     return true;
-  ListNode* node = &nodes;
-  while (node->next != nullptr) {
-    MQTTTopic* value = node->data;
+  for (uint16_t i = 0; i < childCount; i++) {
+    MQTTTopic* value = children[i];
     if (value->isTopicValid()) {
       if (value->processPayload(client, topic, payload))
         return true;
     }
-    node = node->next;
   }
   return false;
 }
@@ -7,69 +7,278 @@
 
 namespace __internal {
 
-  static char topicBuffer[SIMPLEMQTT_MAX_TOPIC_LENGTH + 1];
   const char* EMPTY = "";
 
-  // static memory management >>
-  #if SIMPLEMQTT_STATIC_MEMORY_SIZE > 0
-    static uint8_t staticMemory[SIMPLEMQTT_STATIC_MEMORY_SIZE];
-    static ptrdiff_t memPointer = 0;
+  // Least recently used cache of topic names copied from PROGMEM. A returned name remains valid
+  // until SIMPLEMQTT_PROGMEM_NAME_CACHE other names have been copied from PROGMEM.
+  struct ProgmemName {
+    const char* source = nullptr;
+    uint32_t lastUse = 0;
+    char name[SIMPLEMQTT_MAX_TOPIC_LENGTH + 1];
+  };
+
+  static ProgmemName progmemNames[SIMPLEMQTT_PROGMEM_NAME_CACHE];
+  static uint32_t progmemNameClock = 0;
+
+  inline const char* getProgmemName(const char* source) {
+    ProgmemName* slot = &progmemNames[0];
+    for (uint8_t i = 0; i < SIMPLEMQTT_PROGMEM_NAME_CACHE; i++) {
+      ProgmemName& entry = progmemNames[i];
+      if (entry.source == source) {
+        entry.lastUse = ++progmemNameClock;
+        return entry.name;
+      }
+      if (entry.lastUse < slot->lastUse)
+        slot = &entry;
+    }
+    strncpy_P(slot->name, source, SIMPLEMQTT_MAX_TOPIC_LENGTH);
+    slot->name[SIMPLEMQTT_MAX_TOPIC_LENGTH] = '\0';
+    slot->source = source;
+    slot->lastUse = ++progmemNameClock;
+    return slot->name;
+  }
 
+  // Incremented whenever topics are added or settings change that affect the topics a client listens to.
+  // Structures derived from the topic tree compare against this value to detect that they are outdated.
+  static uint16_t treeVersion = 0;
+
+  // Incremented whenever settings change that affect the full topic names (topic order, patterns, parents).
+  // Cached topic names compare against this value to detect that they are outdated.
+  static uint16_t pathVersion = 0;
+
+  // FNV-1a hash of a zero-terminated string.
+  static uint32_t hashString(const char* s) {
+    uint32_t hash = 2166136261u;
+    while (*s != '\0') {
+      hash ^= (uint8_t)*s++;
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+
+  // Print target for payloads that are being published. Stores the first SIMPLEMQTT_PUBLISH_BUFFER bytes.
+  // The rest is appended to the overflow String if one is given, otherwise it is only counted.
+  class PayloadBuffer : public Print {
+    String* overflow;
+    size_t used = 0;
+    size_t count = 0;
+    uint32_t hashValue = 2166136261u;  // FNV-1a
+
+  public:
+    uint8_t data[SIMPLEMQTT_PUBLISH_BUFFER];
+
+    PayloadBuffer(String* anOverflow = nullptr) : overflow(anOverflow) {};
+
+    size_t write(uint8_t c) override {
+      return write(&c, 1);
+    };
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+      count += size;
+      for (size_t i = 0; i < size; i++)
+        hashValue = (hashValue ^ buffer[i]) * 16777619u;
+      size_t n = (size < SIMPLEMQTT_PUBLISH_BUFFER - used ? size : SIMPLEMQTT_PUBLISH_BUFFER - used);
+      memcpy(data + used, buffer, n);
+      used += n;
+      // grow the overflow in steps to limit reallocations; isComplete() detects a failed allocation
+      if (n < size && overflow != nullptr && overflow->reserve(overflow->length() + size - n + SIMPLEMQTT_PUBLISH_BUFFER)) {
+        for (size_t i = n; i < size; i++)
+          *overflow += (char)buffer[i];
+      }
+      return size;
+    };
+
+    // Writes the stored bytes to the given Print.
+    void writeTo(Print& p) const {
+      p.write(data, used);
+      if (overflow != nullptr && overflow->length() > 0)
+        p.write((const uint8_t*)overflow->c_str(), overflow->length());
+    };
+
+    // Returns the number of bytes written.
+    size_t length() const {
+      return count;
+    };
+
+    // Returns a hash of all bytes written. Never returns 0.
+    uint32_t hash() const {
+      return (hashValue == 0 ? 1 : hashValue);
+    };
+
+    // Returns whether all bytes written are stored in the buffer and the overflow.
+    bool isComplete() const {
+      return count == used + (overflow != nullptr ? overflow->length() : 0);
+    };
+  };
+
+  // Formatted payload of a topic that is kept until the value changes.
+  struct PayloadCache {
+    String payload;
+    bool enabled = false;
+    bool valid = false;
+  };
+
+  // Check interval of a topic that is not checked on every pass.
+  struct CheckTimer {
+    uint32_t interval = 0;   // milliseconds
+    uint32_t lastCheck = 0;  // millis() of the last check
+  };
+
+  // Publish policy state of a formatted topic. Publish policies apply to arithmetic types only,
+  // other types use the empty specialization.
+  template<typename T, bool = std::is_arithmetic_v<T>>
+  struct PublishPolicyState {};
+
+  template<typename T>
+  struct PublishPolicyState<T, true> {
+    PublishPolicy publishPolicy = PublishPolicy::ALWAYS;
+    float deadband = 0;
+    std::remove_const_t<T> publishedValue{};
+  };
+
+  // memory management >>
+  #if SIMPLEMQTT_STATIC_MEMORY_SIZE > 0 || SIMPLEMQTT_HEAP_SLAB_SIZE > 0
+  #if SIMPLEMQTT_STATIC_MEMORY_SIZE > 0
     // satisfy alignment requirements
     #define SIMPLEMQTT_MEMALIGN         4
-    #define SIMPLEMQTT_MEMBLOCK(size)   ((size + (SIMPLEMQTT_MEMALIGN - 1)) & ~(SIMPLEMQTT_MEMALIGN - 1))
 
-    template<typename T>
-    T* allocate(T object) {
-      size_t size = SIMPLEMQTT_MEMBLOCK(sizeof(T));
-      if (SIMPLEMQTT_DEBUG_MEMORY)
-        SIMPLEMQTT_DEBUG(PSTR("Allocating %d bytes for object at address %d...\n"), size, memPointer);
-      if (memPointer + size > SIMPLEMQTT_STATIC_MEMORY_SIZE)
-        return nullptr;
-      memcpy(&staticMemory[memPointer], &object, size);
-      memPointer += size;
-      if (SIMPLEMQTT_DEBUG_MEMORY)
-        SIMPLEMQTT_DEBUG(PSTR("Success, new address is %d\n"), memPointer);
-      return (T*)(void*)(&staticMemory[memPointer - size]);
+    alignas(SIMPLEMQTT_MEMALIGN) static uint8_t staticMemory[SIMPLEMQTT_STATIC_MEMORY_SIZE];
+    static ptrdiff_t memPointer = 0;
+
+    // largest block that is taken from the static memory
+    #define SIMPLEMQTT_MAX_BLOCK_SIZE   SIMPLEMQTT_STATIC_MEMORY_SIZE
+  #else
+    static uint8_t* heapSlab = nullptr;  // slab that new blocks are taken from
+    static size_t slabPointer = SIMPLEMQTT_HEAP_SLAB_SIZE;
+    static uint16_t heapSlabs = 0;       // number of slabs allocated
+
+    // larger blocks are allocated on the heap individually
+    #define SIMPLEMQTT_MAX_BLOCK_SIZE   (SIMPLEMQTT_HEAP_SLAB_SIZE / 4)
+  #endif
+
+    // Memory is handed out in blocks of fixed size classes (8, 12, 16, 24, 32, 48, ... bytes).
+    // Blocks are taken from the static memory or from heap slabs on first use. Deallocated blocks
+    // are kept in a free list per size class and reused by the next allocation of the same class.
+    constexpr size_t memClassSize(uint8_t sizeClass) {
+      return (size_t)((sizeClass & 1) ? 12 : 8) << (sizeClass >> 1);
     }
 
-    template<typename T>
-    T* allocate(size_t length) {
-      if (length == 0)
-        return nullptr;
-      size_t size = SIMPLEMQTT_MEMBLOCK(length);
+    constexpr uint8_t memClassCount() {
+      uint8_t count = 0;
+      while (memClassSize(count) <= SIMPLEMQTT_MAX_BLOCK_SIZE)
+        count++;
+      return count;
+    }
+
+    static const uint8_t MEM_CLASSES = memClassCount();
+
+    inline uint8_t memClass(size_t length) {
+      if (length <= 8)
+        return 0;
+      uint8_t bit = 31 - __builtin_clz((uint32_t)(length - 1));
+      return (length <= ((size_t)3 << (bit - 1)) ? 2 * bit - 5 : 2 * bit - 4);
+    }
+
+    struct MemoryPool {
+      void* freeList = nullptr;
+      uint16_t used = 0;       // blocks currently allocated
+      uint16_t highWater = 0;  // maximum number of blocks allocated at the same time
+    };
+
+    static MemoryPool memoryPools[MEM_CLASSES];
+
+  #if SIMPLEMQTT_STATIC_MEMORY_SIZE > 0
+    inline void* newBlock(size_t size) {
       if (SIMPLEMQTT_DEBUG_MEMORY)
         SIMPLEMQTT_DEBUG(PSTR("Allocating %d bytes at address %d...\n"), size, memPointer);
       if (memPointer + size > SIMPLEMQTT_STATIC_MEMORY_SIZE)
         return nullptr;
+      void* block = &staticMemory[memPointer];
       memPointer += size;
       if (SIMPLEMQTT_DEBUG_MEMORY)
         SIMPLEMQTT_DEBUG(PSTR("Success, new address is %d\n"), memPointer);
-      return (T*)(void*)(&staticMemory[memPointer - size]);
+      return block;
     }
-
-    template<typename T>
-    void deallocate(T*) {
-      size_t size = SIMPLEMQTT_MEMBLOCK(sizeof(T));
-      if (SIMPLEMQTT_DEBUG_MEMORY)
-        SIMPLEMQTT_DEBUG(PSTR("Deallocating %d bytes from address %d...\n"), size, memPointer);
-      memPointer -= size;
+  #else
+    inline void* newBlock(size_t size) {
+      // align the block to the largest power of two that divides its size
+      size_t align = size & (~size + 1);
+      if (align > alignof(std::max_align_t))
+        align = alignof(std::max_align_t);
+      size_t start = (slabPointer + align - 1) & ~(align - 1);
+      if (start + size > SIMPLEMQTT_HEAP_SLAB_SIZE) {
+        // the rest of the current slab is left unused
+        uint8_t* slab = (uint8_t*)malloc(SIMPLEMQTT_HEAP_SLAB_SIZE);
+        if (slab == nullptr)
+          return nullptr;
+        if (SIMPLEMQTT_DEBUG_MEMORY)
+          SIMPLEMQTT_DEBUG(PSTR("Allocated heap slab of %d bytes\n"), SIMPLEMQTT_HEAP_SLAB_SIZE);
+        heapSlab = slab;
+        heapSlabs++;
+        start = 0;
+      }
       if (SIMPLEMQTT_DEBUG_MEMORY)
-        SIMPLEMQTT_DEBUG(PSTR("New address is %d\n"), memPointer);
+        SIMPLEMQTT_DEBUG(PSTR("Allocating %d bytes in slab %d at offset %d\n"), size, heapSlabs, start);
+      slabPointer = start + size;
+      return heapSlab + start;
     }
+  #endif
 
-    void deallocate(size_t length) {
+    inline void* allocateBlock(size_t length) {
       if (length == 0)
+        return nullptr;
+      uint8_t sizeClass = memClass(length);
+      if (sizeClass >= MEM_CLASSES)
+  #if SIMPLEMQTT_STATIC_MEMORY_SIZE > 0
+        return nullptr;
+  #else
+        return malloc(length);
+  #endif
+      MemoryPool& pool = memoryPools[sizeClass];
+      void* block = pool.freeList;
+      if (block != nullptr) {
+        memcpy(&pool.freeList, block, sizeof(void*));
+        if (SIMPLEMQTT_DEBUG_MEMORY)
+          SIMPLEMQTT_DEBUG(PSTR("Reusing %d bytes for %d bytes\n"), memClassSize(sizeClass), length);
+      } else {
+        block = newBlock(memClassSize(sizeClass));
+        if (block == nullptr)
+          return nullptr;
+      }
+      if (++pool.used > pool.highWater)
+        pool.highWater = pool.used;
+      return block;
+    }
+
+    inline void deallocateBlock(const void* block, size_t length) {
+      if (block == nullptr || length == 0)
         return;
-      size_t size = SIMPLEMQTT_MEMBLOCK(length);
-      if (SIMPLEMQTT_DEBUG_MEMORY)
-        SIMPLEMQTT_DEBUG(PSTR("Deallocating %d bytes from address %d...\n"), size, memPointer);
-      memPointer -= size;
+      uint8_t sizeClass = memClass(length);
+  #if SIMPLEMQTT_STATIC_MEMORY_SIZE == 0
+      if (sizeClass >= MEM_CLASSES) {
+        free((void*)block);
+        return;
+      }
+  #endif
+      MemoryPool& pool = memoryPools[sizeClass];
       if (SIMPLEMQTT_DEBUG_MEMORY)
-        SIMPLEMQTT_DEBUG(PSTR("New address is %d\n"), memPointer);
+        SIMPLEMQTT_DEBUG(PSTR("Deallocating %d bytes\n"), length);
+      memcpy((void*)block, &pool.freeList, sizeof(void*));
+      pool.freeList = (void*)block;
+      pool.used--;
+    }
+
+    // Constructs an object in a new block. The constructor function performs a placement new
+    // in the context of the caller which may access non-public constructors.
+    template<typename T, typename Constructor>
+    T* allocate(Constructor constructor) {
+      void* block = allocateBlock(sizeof(T));
+      if (block == nullptr)
+        return nullptr;
+      return constructor(block);
     }
   #endif
-  // << static memory management
+  // << memory management
 
   extern const void* INVALID_PTR;  // pointer to fallback object in case memory allocation fails
 
@@ -86,20 +295,108 @@ namespace __internal {
     return object;
   };
 
-  #if SIMPLEMQTT_STATIC_MEMORY_SIZE > 0
-    #define SIMPLEMQTT_ALLOCATE_MEM(typeName, length)    __internal::allocate<typeName>(length)
-    #define SIMPLEMQTT_ALLOCATE_CLASS(className, ...)    __internal::allocate(className(__VA_ARGS__))
+  #if SIMPLEMQTT_STATIC_MEMORY_SIZE > 0 || SIMPLEMQTT_HEAP_SLAB_SIZE > 0
+    #define SIMPLEMQTT_ALLOCATE_MEM(typeName, length)    (typeName*)__internal::allocateBlock(length)
+    #define SIMPLEMQTT_ALLOCATE_CLASS(className, ...)    __internal::allocate<className>([&](void* block) { return ::new (block) className(__VA_ARGS__); })
     #define SIMPLEMQTT_ALLOCATE(className, ...)          __internal::checkAllocation<className>(SIMPLEMQTT_ALLOCATE_CLASS(className, __VA_ARGS__), #className);
-    #define SIMPLEMQTT_DEALLOCATE_MEM(object, length)    __internal::deallocate(length)
-    #define SIMPLEMQTT_DEALLOCATE(object)                __internal::deallocate(object);
+    #define SIMPLEMQTT_DEALLOCATE_MEM(object, length)    __internal::deallocateBlock(object, length)
+    #define SIMPLEMQTT_DEALLOCATE(object)                { typedef std::remove_pointer_t<decltype(object)> objectType; (object)->~objectType(); __internal::deallocateBlock(object, sizeof(objectType)); }
   #else
     #define SIMPLEMQTT_ALLOCATE_MEM(typeName, length)    (typeName*)malloc(length)
     #define SIMPLEMQTT_ALLOCATE_CLASS(className, ...)    new (std::nothrow) className(__VA_ARGS__)
     #define SIMPLEMQTT_ALLOCATE(className, ...)          __internal::checkAllocation<className>(SIMPLEMQTT_ALLOCATE_CLASS(className, __VA_ARGS__), #className);
     #define SIMPLEMQTT_DEALLOCATE_MEM(object, length)    { free((void*)object); }
-    #define SIMPLEMQTT_DEALLOCATE(object)                { free((void*)object); }
+    #define SIMPLEMQTT_DEALLOCATE(object)                { delete (object); }
   #endif
 
+  // Storage for strings that are kept until the arena is reset. Strings are stored consecutively
+  // in chunks to avoid the overhead and fragmentation of individual allocations.
+  class StringArena {
+    struct Chunk {
+      Chunk* next;
+      size_t size;
+      size_t used;
+    };
+
+    Chunk* chunks = nullptr;
+
+  public:
+    uint16_t version = 0;
+
+    // Copies the string into the arena. Returns nullptr if there is not enough memory.
+    const char* add(const char* s, size_t length) {
+      if (chunks == nullptr || chunks->size - chunks->used < length + 1) {
+        // the chunk size includes the chunk header to fit exactly into a static memory block
+        size_t size = (sizeof(Chunk) + length + 1 > SIMPLEMQTT_TOPIC_ARENA_CHUNK ? length + 1 : SIMPLEMQTT_TOPIC_ARENA_CHUNK - sizeof(Chunk));
+        Chunk* chunk = (Chunk*)SIMPLEMQTT_ALLOCATE_MEM(uint8_t, sizeof(Chunk) + size);
+        if (chunk == nullptr)
+          return nullptr;
+        if (SIMPLEMQTT_DEBUG_MEMORY)
+          SIMPLEMQTT_DEBUG(PSTR("Allocated arena chunk of %d bytes\n"), size);
+        chunk->next = chunks;
+        chunk->size = size;
+        chunk->used = 0;
+        chunks = chunk;
+      }
+      char* result = (char*)(chunks + 1) + chunks->used;
+      memcpy(result, s, length);
+      result[length] = '\0';
+      chunks->used += length + 1;
+      return result;
+    };
+
+    // Releases the given string if it is the one that has been added last.
+    void release(const char* s) {
+      if (chunks != nullptr && s >= (const char*)(chunks + 1) && s < (const char*)(chunks + 1) + chunks->used)
+        chunks->used = s - (const char*)(chunks + 1);
+    };
+
+    ~StringArena() {
+      reset();
+    };
+
+    // Returns whether the arena contains the given string.
+    bool contains(const char* s) const {
+      for (const Chunk* chunk = chunks; chunk != nullptr; chunk = chunk->next) {
+        const char* str = (const char*)(chunk + 1);
+        const char* end = str + chunk->used;
+        for (; str < end; str += strlen(str) + 1) {
+          if (strcmp(str, s) == 0)
+            return true;
+        }
+      }
+      return false;
+    };
+
+    // Releases all strings.
+    void reset() {
+      while (chunks != nullptr) {
+        Chunk* chunk = chunks;
+        chunks = chunk->next;
+        SIMPLEMQTT_DEALLOCATE_MEM(chunk, sizeof(Chunk) + chunk->size);
+      }
+    };
+  };
+
+  // arena for the cached topic names
+  static StringArena topicArena;
+
+  // Replaces each level of the given part of a topic name by a single-level wildcard.
+  static String wildcardLevels(const char* s, size_t length) {
+    String result;
+    bool inLevel = false;
+    for (size_t i = 0; i < length; i++) {
+      if (s[i] == '/') {
+        result += '/';
+        inLevel = false;
+      } else if (!inLevel) {
+        result += '+';
+        inLevel = true;
+      }
+    }
+    return result;
+  }
+
   class _Topic {
   protected:
     const char* topic;
@@ -142,8 +439,7 @@ namespace __internal {
       if ((flags & 1) == 0)
         return topic;
       // from flash
-      strncpy_P(topicBuffer, topic, SIMPLEMQTT_MAX_TOPIC_LENGTH);
-      return topicBuffer;
+      return getProgmemName(topic);
     };
 
     bool isValid() {
@@ -20,13 +20,11 @@ friend class MQTTGroup;
 protected:
   typedef typename std::remove_pointer_t<T> E;
   typedef ResultCode (*PayloadHandler)(MQTTArray<T>& object, const char* payload);
-  PayloadHandler payloadHandler = [](MQTTArray<T>& object, const char* payload) {
-    return object.setFromPayload(payload);
-  };
+  PayloadHandler payloadHandler = nullptr;  // setFromPayload() is used if not set
   typename std::remove_const_t<T> array = nullptr;
   size_t length = 0;
   char separator = ',';
-  typename mqtt_variable<E>::type helper;  // conversion helper
+  typename mqtt_variable<E>::type helper;  // conversion helper, not part of the topic tree
 
   template<typename E>
   class ElementProxy {
@@ -58,14 +56,7 @@ protected:
     }
 
     template<typename U = E, typename std::enable_if<!std::is_const_v<U>, bool>::type* = nullptr> // only for non-const types
-    ResultCode setFromPayload(const char* payload) {
-/*      
-      Serial.print("ElementProxy.setFromPayload(");
-      Serial.print(index);
-      Serial.print(", ");
-      Serial.print(payload);
-      Serial.println(")");
-*/
+    ResultCode setFromPayload(std::string_view payload) {
       return parent->setFromPayload(index, payload);
     };
 
@@ -83,7 +74,7 @@ protected:
 
   MQTTArray(MQTTGroup* aParent, __internal::_Topic aTopic, uint8_t aConfig, T arr, size_t elementCount)
     : MQTTTopic(aParent, aTopic, aConfig),
-      array(arr), length(elementCount), helper(aParent, aTopic, aConfig, arr) {
+      array(arr), length(elementCount), helper(nullptr, aTopic, aConfig, arr) {
     helper.setSettable(true);
   };
 
@@ -101,6 +92,7 @@ protected:
   void _setValue(T const sourceArray) {
     SIMPLEMQTT_CHECK_VALID();
     memcpy(array, sourceArray, sizeof(E) * length);
+    MQTTTopic::invalidatePayload();
   };
 
   template<typename U = T, typename std::enable_if<std::is_const_v<std::remove_pointer_t<U>>, bool>::type* = nullptr> // only for const types
@@ -111,12 +103,12 @@ protected:
     return memcmp(array, other, sizeof(E) * length) == 0;
   };
 
-  ResultCode setReceived(const char* payload) override {
+  ResultCode setReceived(std::string_view payload) override {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
     if (MQTTTopic::isAutoPublish())
       MQTTTopic::republish();
     if (payloadHandler != nullptr)
-      return payloadHandler(*this, payload);
+      return payloadHandler(*this, __internal::payloadToString(payload).c_str());
     return setFromPayload(payload);
   };
 
@@ -155,6 +147,7 @@ public:
   inline void setSeparator(const char s) {
     if (s != '\0')
       separator = s;
+    MQTTTopic::invalidatePayload();
   }
 
   String getPayload(size_t index) const {
@@ -179,6 +172,18 @@ public:
     return result;
   };
 
+  size_t printPayload(Print& p) const override {
+    SIMPLEMQTT_CHECK_VALID(0);
+    size_t n = 0;
+    for (size_t i = 0; i < length; i++) {
+      const_cast<MQTTArray<T>*>(this)->helper.setPointer(&array[i]);
+      n += helper.printPayload(p);
+      if (i < length - 1)
+        n += p.print(separator);
+    }
+    return n;
+  };
+
   // Sets the value of the element at the given index. Returns whether the value has changed
   // and auto-publishes the array if necessary.
   template<typename U = E, typename std::enable_if<!std::is_const_v<U>, bool>::type* = nullptr> // only for non-const types
@@ -190,6 +195,8 @@ public:
     helper.hasBeenChanged();  // clear flag
     helper.setTo(newValue);
     bool changed = helper.hasBeenChanged();
+    if (changed)
+      MQTTTopic::invalidatePayload();
     if (changed && MQTTTopic::isAutoPublish())
       MQTTTopic::republish();
     return changed;
@@ -198,7 +205,7 @@ public:
   // Sets the value of the element at the given index from the specified payload.
   // Auto-publishes the array if necessary.
   template<typename U = E, typename std::enable_if<!std::is_const_v<U>, bool>::type* = nullptr> // only for non-const types
-  ResultCode setFromPayload(size_t index, const char* payload) {
+  ResultCode setFromPayload(size_t index, std::string_view payload) {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
     if (index >= length)
       return ResultCode::CANNOT_SET;
@@ -206,6 +213,8 @@ public:
     helper.hasBeenChanged();  // clear flag
     helper.setFromPayload(payload);
     bool changed = helper.hasBeenChanged();
+    if (changed)
+      MQTTTopic::invalidatePayload();
     if (changed && MQTTTopic::isAutoPublish())
       MQTTTopic::republish();
     return ResultCode::OK;
@@ -217,12 +226,12 @@ public:
     return *this;
   };
 
-  ResultCode setFromPayload(const char* payload) override {
+  ResultCode setFromPayload(std::string_view payload) override {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
     SIMPLEMQTT_DEBUG_SET_FROM_PAYLOAD;
     if (!isSettable())
       return ResultCode::CANNOT_SET;
-    if (payload[0] == '\0')
+    if (payload.empty())
       return ResultCode::OK;
     if constexpr (std::is_const_v<std::remove_pointer<T>>)
       return ResultCode::CANNOT_SET;
@@ -234,32 +243,24 @@ public:
       // iterate through values
       // expected format: "<v1>,<v2>,..."
       size_t i = 0;
-      const char* s = payload;
-      while (*s != '\0' && i < length) {
-        // modifies payload temporarily in-place
-        char* e = (char*)s;
-        while (*e != separator && *e != '\0') {
-          e++;
-        }
+      size_t s = 0;
+      while (s < payload.length() && i < length) {
+        // the values are passed as views into the payload, it is not modified
+        size_t e = payload.find(separator, s);
+        if (e == std::string_view::npos)
+          e = payload.length();
         // empty value? skip
         if (e == s) {
           s++;
           i++;
           continue;
         }
-        bool atEnd = *e == '\0';
-        // mark end for value parser
-        *e = '\0';
         helper.setPointer(&newValues[i]);
         // helper handles conversion
-        ResultCode code = helper.setReceived(s);
+        ResultCode code = helper.setReceived(payload.substr(s, e - s));
         if (code != ResultCode::OK)
           return code;
-        if (!atEnd) {
-          *e = separator;
-          s = e + 1;
-        } else
-          break;
+        s = e + 1;
         i++;
       }
       bool changed = set((T)&newValues, true);
@@ -276,6 +277,7 @@ public:
   virtual MQTTArray<T>& setFormat(typename format_type<E>::type aFormat) {
     SIMPLEMQTT_CHECK_VALID(*this);
     helper.format = aFormat;
+    MQTTTopic::invalidatePayload();
     return *this;
   };
 
@@ -326,15 +328,28 @@ protected:
     SIMPLEMQTT_CHECK_VALID(*this);
     strncpy(array, sourceArray, length - 1);
     array[length - 1] = '\0';
+    MQTTTopic::invalidatePayload();
     return *this;
   };
 
+  // Copies the characters into the array, truncating them if necessary. Returns whether the value has changed.
+  bool _setValue(std::string_view newValue) {
+    SIMPLEMQTT_CHECK_VALID(false);
+    size_t n = (newValue.length() < length - 1 ? newValue.length() : length - 1);
+    if (strlen(array) == n && memcmp(array, newValue.data(), n) == 0)
+      return false;
+    memcpy(array, newValue.data(), n);
+    memset(&array[n], 0, length - n);
+    MQTTTopic::invalidatePayload();
+    return true;
+  };
+
 public:
   SIMPLEMQTT_OVERRIDE_SETTERS(MQTTCharArray)
 
-  ResultCode setFromPayload(const char* payload) override {
+  ResultCode setFromPayload(std::string_view payload) override {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
-    _setValue((char*)payload);
+    _setValue(payload);
     return ResultCode::OK;
   };
 
@@ -342,11 +357,73 @@ public:
     SIMPLEMQTT_CHECK_VALID(String());
     return String(array);
   };
+
+  size_t printPayload(Print& p) const override {
+    SIMPLEMQTT_CHECK_VALID(0);
+    return p.print(array);
+  };
 };
 
 template<>
 struct mqtt_array_type<char*> { typedef MQTTCharArray& type; };
 
+// String topic with an inline buffer of N characters including the terminating zero.
+// Does not use the heap; longer values are truncated.
+template<size_t N>
+class MQTTFixedString : public MQTTCharArray {
+  friend class MQTTGroup;
+
+protected:
+  char data[N]{};
+
+  MQTTFixedString(MQTTGroup* aParent, __internal::_Topic aTopic, uint8_t aConfig)
+    : MQTTCharArray(aParent, aTopic, aConfig, &data[0], N) {};
+
+public:
+  SIMPLEMQTT_OVERRIDE_SETTERS(MQTTFixedString<N>)
+
+  // Returns the current value of this topic.
+  inline const char* value() const {
+    return data;
+  };
+
+  inline operator const char*() const {
+    return data;
+  };
+
+  // Sets the current value of this topic. Returns whether the value has changed.
+  // Does not modify the Changed flag.
+  bool set(std::string_view newValue) {
+    SIMPLEMQTT_CHECK_VALID(false);
+    bool changed = _setValue(newValue);
+    if (changed && MQTTTopic::isAutoPublish())
+      MQTTTopic::republish();
+    return changed;
+  };
+
+  // Sets the current value of this topic and sets the Changed flag if the value has changed.
+  MQTTFixedString<N>& setTo(std::string_view newValue) {
+    SIMPLEMQTT_CHECK_VALID(*this);
+    bool changed = set(newValue);
+    MQTTTopic::setChanged(MQTTTopic::hasBeenChanged(false) || changed);
+    return *this;
+  };
+
+  inline MQTTFixedString<N>& operator=(std::string_view newValue) { set(newValue); return *this; };
+  inline MQTTFixedString<N>& operator=(const char* newValue) { set(newValue); return *this; };
+  inline MQTTFixedString<N>& operator=(const String& newValue) { set(std::string_view(newValue.c_str(), newValue.length())); return *this; };
+
+  ResultCode setFromPayload(std::string_view payload) override {
+    SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
+    SIMPLEMQTT_DEBUG_SET_FROM_PAYLOAD;
+    setTo(payload);
+    return ResultCode::OK;
+  };
+};
+
+template<size_t N>
+struct mqtt_fixedstring_type { typedef MQTTFixedString<N>& type; };
+
 // Array topic representing a const char* string.
 class MQTTConstCharArray : public MQTTArray<const char*> {
   friend class MQTTGroup;
@@ -362,6 +439,11 @@ public:
     SIMPLEMQTT_CHECK_VALID(String());
     return String(array);
   };
+
+  size_t printPayload(Print& p) const override {
+    SIMPLEMQTT_CHECK_VALID(0);
+    return p.print(array);
+  };
 };
 
 template<>
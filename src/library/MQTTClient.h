@@ -5,6 +5,18 @@
 // https://github.com/leomeyer/SimpleMQTT
 /////////////////////////////////////////////////////////////////////
 
+namespace __internal {
+
+  // Position of a depth-first pass over a topic tree that can be continued in a later call.
+  struct TreeCursor {
+    MQTTGroup* groups[SIMPLEMQTT_MAX_TREE_DEPTH];
+    uint16_t positions[SIMPLEMQTT_MAX_TREE_DEPTH];
+    uint8_t depth = 0;     // 0 if no pass is in progress
+    uint32_t started = 0;  // millis() at the start of the pass
+  };
+
+}  // namespace __internal
+
 // The SimpleMQTT client class that is used to define topics and handle MQTT communication.
 class SimpleMQTTClient : public PubSubClient, public MQTTGroup {
 friend class MQTTTopic;
@@ -16,6 +28,8 @@ private:
   void* operator new[](size_t, void*);  // placement array new
 
 public:
+  typedef void (*ChangeCallback)(MQTTTopic& topic);
+
   enum class State : int8_t {
     INVALID_NAME = -3,
     INVALID_TOPIC = -2,
@@ -38,6 +52,45 @@ protected:
   MQTT_CALLBACK_SIGNATURE = nullptr;
   State previousState = State::DISCONNECTED;
   TopicOrder globalTopicOrder = DEFAULT_TOPIC_ORDER;
+  __internal::TopicIndex topicIndex;
+  __internal::WatchRegion watchRegion;
+  bool wildcardSubscriptions = false;
+  __internal::StringArena subscribedFilters;
+  MQTTTopic* changeHead = nullptr;  // queue of changed topics, linked by MQTTTopic::nextChange
+  MQTTTopic* changeTail = nullptr;
+  ChangeCallback changeCallback = nullptr;
+  __internal::TimerWheel timerWheel;
+  uint32_t minReconnectDelay = 1000;   // milliseconds
+  uint32_t maxReconnectDelay = 60000;  // milliseconds
+  uint32_t reconnectDelay = 0;         // current backoff delay, 0 after a successful connect
+  uint32_t nextConnect = 0;            // millis() of the next connect attempt
+  bool connectScheduled = false;       // a failed connect attempt delays the next one
+  uint16_t failedConnects = 0;         // consecutive failed connect attempts
+  bool fullResync = false;             // publish all topics after a reconnect, even unchanged ones
+  uint32_t handleBudget = 0;  // microseconds, 0 = unlimited
+  uint16_t checkLimit = 0;    // topics examined per call of handle(), 0 = unlimited
+  uint32_t sweepTime = 0;     // milliseconds of the last complete check pass
+  uint32_t maxSweepTime = 0;
+  uint32_t handleStart = 0;
+  __internal::TreeCursor syncCursor;  // subscribing and publishing all topics after connect
+  __internal::TreeCursor checkCursor;
+  __internal::TreeCursor publishCursor;
+
+  enum class Pass : uint8_t {
+    SUBSCRIBE,
+    PUBLISH_ALL,
+    CHECK,
+    PUBLISH
+  };
+  Pass syncPass = Pass::SUBSCRIBE;
+#if SIMPLEMQTT_OFFLINE_BUFFER > 0
+  __internal::OfflineBuffer offlineBuffer;
+  OfflinePolicy offlinePolicy = OfflinePolicy::DROP_OLDEST;
+  uint32_t offlineDrainInterval = 0;  // milliseconds between sending recorded publishes, 0 = unlimited
+  uint32_t offlineMaxAge = 0;         // milliseconds, 0 = unlimited
+  uint32_t nextDrain = 0;
+  bool offlineRecording = false;      // set after the first connect
+#endif
 
   inline String type() const override { return String("$"); };
 
@@ -49,6 +102,311 @@ protected:
     return this;
   };
 
+  // Processes a topic as a whole, including its subtopics.
+  void processTopic(MQTTTopic* topic, Pass pass) {
+    switch (pass) {
+      case Pass::SUBSCRIBE:
+        topic->addSubscriptions(this);
+        break;
+      case Pass::PUBLISH_ALL:
+        // take over changes made while disconnected so that the next check does not publish them again
+        topic->check();
+        topic->publish(true);
+        break;
+      case Pass::CHECK:
+        if (!topic->inWatchRegion && topic->isCheckDue())
+          topic->check();
+        break;
+      case Pass::PUBLISH:
+        if (topic->needsPublish())
+          topic->publish();
+        break;
+    }
+  };
+
+  // Processes the part of a group that does not concern its subtopics.
+  // Returns whether the subtopics are to be processed.
+  bool enterGroup(MQTTGroup* group, Pass pass) {
+    switch (pass) {
+      case Pass::SUBSCRIBE:
+        group->MQTTTopic::addSubscriptions(this);
+        return true;
+      case Pass::PUBLISH_ALL:
+        group->config &= PUBLISH_CLEARMASK;
+        return true;
+      case Pass::CHECK:
+        return group->isCheckDue() && group->MQTTTopic::check();
+      case Pass::PUBLISH:
+        if (!group->needsPublish())
+          return false;
+        // clear the flag first; subtopics that are republished during this pass set it again
+        group->config &= PUBLISH_CLEARMASK;
+        return true;
+    }
+    return false;
+  };
+
+  // Returns whether the time budget of the current handle() call has been used up.
+  bool isBudgetExhausted() const {
+    return handleBudget > 0 && (uint32_t)(micros() - handleStart) >= handleBudget;
+  };
+
+  // Processes the topic tree depth-first, starting a new pass if none is in progress.
+  // Stops when the time budget is exhausted, after having processed at least one topic,
+  // or when the given number of topics has been processed (0 = unlimited).
+  // Returns whether the pass has been completed.
+  bool continuePass(__internal::TreeCursor& cursor, Pass pass, uint16_t limit = 0) {
+    if (cursor.depth == 0) {
+      cursor.started = millis();
+      if (!enterGroup(this, pass))
+        return true;
+      cursor.groups[0] = this;
+      cursor.positions[0] = 0;
+      cursor.depth = 1;
+    }
+    bool progress = false;
+    uint16_t processed = 0;
+    while (cursor.depth > 0) {
+      MQTTGroup* group = cursor.groups[cursor.depth - 1];
+      uint16_t& position = cursor.positions[cursor.depth - 1];
+      if (position >= group->childCount) {
+        cursor.depth--;
+        continue;
+      }
+      if (progress && isBudgetExhausted())
+        return false;
+      if (limit > 0 && processed >= limit)
+        return false;
+      MQTTTopic* topic = group->children[position++];
+      progress = true;
+      processed++;
+      MQTTGroup* subgroup = topic->asGroup();
+      if (subgroup == nullptr || cursor.depth == SIMPLEMQTT_MAX_TREE_DEPTH)
+        processTopic(topic, pass);
+      else if (enterGroup(subgroup, pass)) {
+        cursor.groups[cursor.depth] = subgroup;
+        cursor.positions[cursor.depth] = 0;
+        cursor.depth++;
+      }
+    }
+    return true;
+  };
+
+  // Continues the pass that checks the topics for changes, examining at most checkLimit topics.
+  // Measures the duration of complete passes which limits the time until a change is detected.
+  bool continueCheck() {
+    if (checkCursor.depth == 0)
+      checkWatchRegion();
+    if (!continuePass(checkCursor, Pass::CHECK, checkLimit))
+      return false;
+    sweepTime = millis() - checkCursor.started;
+    if (sweepTime > maxSweepTime)
+      maxSweepTime = sweepTime;
+    return true;
+  };
+
+  // Subscribes to all topics and publishes them after a connect.
+  // Returns whether this has been completed.
+  bool continueSync() {
+    if (syncPass == Pass::SUBSCRIBE) {
+      if (!continuePass(syncCursor, Pass::SUBSCRIBE))
+        return false;
+      syncPass = Pass::PUBLISH_ALL;
+    }
+    if (syncPass == Pass::PUBLISH_ALL) {
+      if (!continuePass(syncCursor, Pass::PUBLISH_ALL))
+        return false;
+      syncPass = Pass::PUBLISH;
+    }
+    return true;
+  };
+
+  // Returns whether a publish must wait for the minimum publish interval of the topic.
+  // Schedules the timer to request the publish when the interval has passed.
+  bool deferPublish(__internal::PublishTimer* timer) {
+    if (timer->minInterval == 0 || !timer->published)
+      return false;
+    uint32_t due = timer->lastPublish + timer->minInterval;
+    if ((int32_t)(millis() - due) >= 0)
+      return false;
+    if (!timer->deferred) {
+      timer->deferred = true;
+      timerWheel.schedule(timer, due);
+    }
+    return true;
+  };
+
+  // Called after a topic with publish intervals has been published.
+  void restartPublishTimer(__internal::PublishTimer* timer) {
+    timer->lastPublish = millis();
+    timer->published = true;
+    timer->deferred = false;
+    if (timer->maxInterval > 0)
+      timerWheel.schedule(timer, timer->lastPublish + timer->maxInterval);
+    else
+      timerWheel.cancel(timer);
+  };
+
+#if SIMPLEMQTT_OFFLINE_BUFFER > 0
+  // Records the current payload of a topic in the offline buffer.
+  // A publish that is dropped because the buffer is full counts as done so that it is not retried.
+  bool storeOffline(MQTTTopic* value, __internal::PayloadBuffer& buffer) {
+    if (!offlineBuffer.begin(value, buffer.length(), offlinePolicy)) {
+      SIMPLEMQTT_DEBUG(PSTR("Offline buffer full, dropping topic '%s'\n"), value->finalTopicStr());
+      return true;
+    }
+    SIMPLEMQTT_DEBUG(PSTR("Recording topic: '%s' with a payload of %d bytes\n"), value->finalTopicStr(), buffer.length());
+    const String* cached = value->getCachedPayload();
+    if (cached != nullptr)
+      offlineBuffer.write((const uint8_t*)cached->c_str(), cached->length());
+    else
+      buffer.writeTo(offlineBuffer);
+    // the resynchronization after the reconnect does not record the same payload again
+    value->publishedHash = buffer.hash();
+    return true;
+  };
+
+  // Checks and publishes the topics while disconnected so that the publishes of buffered topics are recorded.
+  void recordOffline() {
+    if (!offlineRecording)
+      return;
+    continueCheck();
+    if (publishCursor.depth > 0 || needsPublish())
+      continuePass(publishCursor, Pass::PUBLISH);
+  };
+
+  // Sends the publishes that have been recorded while disconnected, oldest first.
+  // Observes the drain rate and the time budget; stops if a publish fails.
+  void drainOffline() {
+    bool progress = false;
+    while (!offlineBuffer.isEmpty()) {
+      __internal::OfflineBuffer::Record record = offlineBuffer.peek();
+      uint32_t now = millis();
+      if (offlineMaxAge > 0 && now - record.time > offlineMaxAge) {
+        offlineBuffer.pop();
+        offlineBuffer.statistics.expired++;
+        continue;
+      }
+      if (offlineDrainInterval > 0 && (int32_t)(now - nextDrain) < 0)
+        return;
+      if (progress && isBudgetExhausted())
+        return;
+      progress = true;
+      const char* finalTopic = record.topic->finalTopicStr();
+      if (!beginPublish(finalTopic, record.length, record.topic->isRetained()))
+        return;
+      offlineBuffer.printPayload(*static_cast<PubSubClient*>(this), record);
+      if (endPublish() == 0)
+        return;
+      offlineBuffer.pop();
+      offlineBuffer.statistics.sent++;
+      nextDrain = now + offlineDrainInterval;
+    }
+  };
+#endif
+
+  // Schedules the next connect attempt after a failed one using exponential backoff.
+  // The delay is reduced by a random amount of up to half of it so that many clients
+  // do not reconnect at the same time after a broker outage.
+  void scheduleReconnect() {
+    if (reconnectDelay < minReconnectDelay)
+      reconnectDelay = minReconnectDelay;
+    nextConnect = millis() + reconnectDelay - random(reconnectDelay / 2 + 1);
+    connectScheduled = true;
+    reconnectDelay = (reconnectDelay > maxReconnectDelay / 2 ? maxReconnectDelay : reconnectDelay * 2);
+    if (failedConnects < UINT16_MAX)
+      failedConnects++;
+  };
+
+  // Returns whether the topic or one of its groups must be published after each reconnect.
+  bool requiresAnnounce(MQTTTopic* value) const {
+    for (MQTTTopic* t = value; t != nullptr; t = t->_parent) {
+      if (t->mustAnnounce)
+        return true;
+    }
+    return false;
+  };
+
+  // Builds the index that maps incoming topics to their topic objects.
+  void buildIndex() {
+    topicIndex.clear();
+    // count entries
+    addToIndex(this, topicIndex);
+    if (topicIndex.allocate())
+      addToIndex(this, topicIndex);
+    if (!topicIndex.isCurrent())
+      SIMPLEMQTT_ERROR(PSTR("Not enough memory for the topic index, using tree search\n"));
+  };
+
+  // Builds the watch region from the variables of the watched topics.
+  void buildWatchRegion() {
+    watchRegion.clear();
+    // count variables
+    addToWatchRegion(watchRegion);
+    bool built = watchRegion.allocate();
+    if (built) {
+      addToWatchRegion(watchRegion);
+      built = watchRegion.finish();
+    }
+    if (!built) {
+      SIMPLEMQTT_ERROR(PSTR("Not enough memory for the watch region, checking topics individually\n"));
+      watchRegion.clear();
+      // a counting pass removes the topics from the region
+      addToWatchRegion(watchRegion);
+    }
+    watchRegion.setCurrent();
+  };
+
+  // Checks the topics whose watched variables have changed since the last check pass.
+  void checkWatchRegion() {
+    if (!watchRegion.isCurrent())
+      buildWatchRegion();
+    watchRegion.compare([](MQTTTopic* topic) {
+      topic->check();
+    });
+  };
+
+  bool processPayload(SimpleMQTTClient* client, const char* topic, std::string_view payload) override {
+    if (!topicIndex.isCurrent())
+      buildIndex();
+    if (!topicIndex.isCurrent())
+      return MQTTGroup::processPayload(client, topic, payload);
+    const __internal::TopicIndex::Entry* entry = topicIndex.find(topic);
+    if (entry == nullptr)
+      return false;
+    if (entry->kind == __internal::TopicIndex::REQUEST)
+      return entry->topic->processRequest(client, topic, payload);
+    return entry->topic->processSet(client, topic, payload);
+  };
+
+  void queueChange(MQTTTopic* value) {
+    // the last topic in the queue points to the invalid topic to mark it as queued
+    value->nextChange = &MQTTTopic::INVALID_TOPIC;
+    if (changeTail == nullptr)
+      changeHead = value;
+    else
+      changeTail->nextChange = value;
+    changeTail = value;
+  };
+
+  // Subscribes to the given topic or, if wildcard subscriptions are enabled,
+  // to the wildcard filter that covers it if it has not already been subscribed to.
+  bool subscribeTopic(const char* topic, MQTTTopic* value, __internal::TopicIndex::Kind kind) {
+    if (wildcardSubscriptions) {
+      String filter = value->getWildcardTopic(topic, kind);
+      if (filter != "") {
+        if (subscribedFilters.contains(filter.c_str()))
+          return true;
+        // if the filter cannot be stored, subscribe to the topic individually
+        if (subscribedFilters.add(filter.c_str(), filter.length()) != nullptr) {
+          SIMPLEMQTT_DEBUG(PSTR("Subscribing to wildcard topic '%s'\n"), filter.c_str());
+          return subscribe(filter.c_str());
+        }
+      }
+    }
+    return subscribe(topic);
+  };
+
   virtual bool connect() {
     if (mqttWill != nullptr)
       return PubSubClient::connect(mqttClientName, mqttUser, mqttPassword, getFinalTopic(mqttWill->getFullTopic()).c_str(), mqttWill->getQoS(), mqttWill->isRetained(), mqttWill->getMessage(), cleanSession);
@@ -107,6 +465,8 @@ public:
 
   SimpleMQTTClient& setTopicOrder(TopicOrder order) override {
     globalTopicOrder = order;
+    __internal::treeVersion++;
+    __internal::pathVersion++;
     return *this;
   };
 
@@ -117,9 +477,195 @@ public:
     if (!will->isTopicValid())
       return will;
     will->_parent = this;
+    __internal::pathVersion++;
     return will;
   };
 
+  // Returns the next topic that has been changed, in the order of the changes, or nullptr if there are no changed topics.
+  // Clears the changed flag of the returned topic.
+  MQTTTopic* getChange() override {
+    while (changeHead != nullptr) {
+      MQTTTopic* value = changeHead;
+      changeHead = (value->nextChange == &MQTTTopic::INVALID_TOPIC ? nullptr : value->nextChange);
+      if (changeHead == nullptr)
+        changeTail = nullptr;
+      value->nextChange = nullptr;
+      // skip topics whose changed flag has been cleared in the meantime
+      if ((value->config & CHANGED_SETMASK) != 0) {
+        value->config &= CHANGED_CLEARMASK;
+        return value;
+      }
+    }
+    return nullptr;
+  };
+
+  // Sets a function that is called by handle() for each changed topic, in the order of the changes.
+  // Topics that have been passed to this function are no longer returned by getChange().
+  SimpleMQTTClient& setChangeCallback(ChangeCallback callback) {
+    changeCallback = callback;
+    return *this;
+  };
+
+  // Enables or disables wildcard subscriptions. If enabled, the client subscribes to one wildcard
+  // filter per level depth of the request and set topics below the client's topic instead of
+  // subscribing to each topic individually. Top-level topics are still subscribed individually.
+  // Takes effect on the next connect.
+  SimpleMQTTClient& setWildcardSubscriptions(bool enable) {
+    wildcardSubscriptions = enable;
+    return *this;
+  };
+
+  bool isWildcardSubscriptions() const {
+    return wildcardSubscriptions;
+  };
+
+  // Sets the maximum time in microseconds that a call of handle() should take. If the work
+  // (checking and publishing topics, subscribing and publishing all topics after a connect)
+  // takes longer it is continued in the next calls. A single topic is never split and the
+  // processing of incoming messages is not limited. 0 (the default) means unlimited.
+  SimpleMQTTClient& setHandleBudget(uint32_t micros) {
+    handleBudget = micros;
+    return *this;
+  };
+
+  uint32_t getHandleBudget() const {
+    return handleBudget;
+  };
+
+  // Sets the maximum number of topics that are examined for changes per call of handle().
+  // The check continues with the next topics on the next call, so that each topic is checked
+  // once every (number of topics / limit) calls. 0 (the default) means unlimited.
+  SimpleMQTTClient& setCheckLimit(uint16_t topics) {
+    checkLimit = topics;
+    return *this;
+  };
+
+  uint16_t getCheckLimit() const {
+    return checkLimit;
+  };
+
+  // Returns the duration in milliseconds of the last complete pass that checked all topics for changes.
+  // A change of a topic's value is detected within about this time, plus the topic's check interval.
+  uint32_t getSweepTime() const {
+    return sweepTime;
+  };
+
+  // Returns the longest duration of a complete check pass in milliseconds since the start.
+  uint32_t getMaxSweepTime() const {
+    return maxSweepTime;
+  };
+
+  // Sets the delays between connect attempts in milliseconds. After a failed attempt the client waits
+  // for the minimum delay; the delay doubles with each further failed attempt up to the maximum delay.
+  SimpleMQTTClient& setReconnectDelay(uint32_t minDelay, uint32_t maxDelay) {
+    minReconnectDelay = minDelay;
+    maxReconnectDelay = (maxDelay < minDelay ? minDelay : maxDelay);
+    return *this;
+  };
+
+  // Enables or disables the publishing of all topics after a reconnect. By default only topics whose
+  // payload differs from the last one sent to the broker, and topics that must be announced, are published.
+  SimpleMQTTClient& setFullResync(bool enable) {
+    fullResync = enable;
+    return *this;
+  };
+
+  bool isFullResync() const {
+    return fullResync;
+  };
+
+  // Returns the time in milliseconds until the next connect attempt, or 0 if it is due.
+  uint32_t getReconnectWait() const {
+    if (!connectScheduled)
+      return 0;
+    int32_t wait = (int32_t)(nextConnect - millis());
+    return (wait > 0 ? wait : 0);
+  };
+
+  // Returns the number of consecutive failed connect attempts.
+  uint16_t getFailedConnects() const {
+    return failedConnects;
+  };
+
+  // Returns the number of variables whose changes are detected by the watch region (see MQTTTopic::setWatched()).
+  // The region is built at the start of the next check pass after the topic tree has changed.
+  uint16_t getWatchedCount() const {
+    return watchRegion.size();
+  };
+
+  // Returns the time in milliseconds since the oldest unfinished pass over the topics has started,
+  // or 0 if all work has been completed within the last call of handle().
+  uint32_t getLag() const {
+    uint32_t now = millis();
+    uint32_t lag = 0;
+    const __internal::TreeCursor* cursors[] = { &syncCursor, &checkCursor, &publishCursor };
+    for (const __internal::TreeCursor* cursor : cursors) {
+      if (cursor->depth > 0 && now - cursor->started > lag)
+        lag = now - cursor->started;
+    }
+    return lag;
+  };
+
+#if SIMPLEMQTT_STATIC_MEMORY_SIZE > 0 || SIMPLEMQTT_HEAP_SLAB_SIZE > 0
+  // Prints the usage of the static memory or of the heap slabs per block size: blocks in use and maximum blocks in use.
+  static size_t printMemoryUsage(Print& p) {
+    size_t n = 0;
+    for (uint8_t i = 0; i < __internal::MEM_CLASSES; i++) {
+      const __internal::MemoryPool& pool = __internal::memoryPools[i];
+      if (pool.highWater == 0)
+        continue;
+      n += p.print(__internal::memClassSize(i));
+      n += p.print(F(" bytes: used "));
+      n += p.print(pool.used);
+      n += p.print(F(", max "));
+      n += p.println(pool.highWater);
+    }
+#if SIMPLEMQTT_STATIC_MEMORY_SIZE > 0
+    n += p.print(F("total: "));
+    n += p.print(__internal::memPointer);
+    n += p.print(F(" of "));
+    n += p.print(SIMPLEMQTT_STATIC_MEMORY_SIZE);
+    n += p.println(F(" bytes"));
+#else
+    n += p.print(F("slabs: "));
+    n += p.print(__internal::heapSlabs);
+    n += p.print(F(" of "));
+    n += p.print(SIMPLEMQTT_HEAP_SLAB_SIZE);
+    n += p.println(F(" bytes"));
+#endif
+    return n;
+  };
+#endif
+
+#if SIMPLEMQTT_OFFLINE_BUFFER > 0
+  // Sets which publish is dropped when the offline buffer is full.
+  SimpleMQTTClient& setOfflinePolicy(OfflinePolicy policy) {
+    offlinePolicy = policy;
+    return *this;
+  };
+
+  // Limits the number of recorded publishes that are sent per second after a reconnect. 0 means unlimited.
+  SimpleMQTTClient& setOfflineDrainRate(uint16_t messagesPerSecond) {
+    offlineDrainInterval = (messagesPerSecond == 0 ? 0 : 1000 / messagesPerSecond);
+    return *this;
+  };
+
+  // Sets the time in milliseconds after which recorded publishes are discarded instead of being sent. 0 means unlimited.
+  SimpleMQTTClient& setOfflineMaxAge(uint32_t milliseconds) {
+    offlineMaxAge = milliseconds;
+    return *this;
+  };
+
+  // Returns the number of recorded publishes that have not been sent yet.
+  uint16_t getOfflinePending() const {
+    return offlineBuffer.size();
+  };
+
+  const OfflineStatistics& getOfflineStatistics() const {
+    return offlineBuffer.statistics;
+  };
+#endif
+
   virtual String getFinalTopic(const String& topic) {
     if (topic.startsWith("/"))
       return topic.substring(1);
@@ -196,22 +742,56 @@ public:
   bool publish(MQTTTopic* value) {
     if (value == __internal::INVALID_PTR)
       return false;
-    String fullTopic = value->getFullTopic();
+    const char* fullTopic = value->fullTopicStr();
     // top-level-topics are only published if their publish-flag is set
     // to avoid infinite publish/set loop
-    if (fullTopic.startsWith("/") && !value->needsPublish())
+    if (fullTopic[0] == '/' && !value->needsPublish())
+      return false;
+    const char* finalTopic = value->finalTopicStr();
+    if (finalTopic[0] == '\0')
+      return false;
+#if SIMPLEMQTT_OFFLINE_BUFFER > 0
+    // while disconnected only buffered topics are recorded; the others are published after the reconnect
+    if (!value->buffered && !connected())
       return false;
-    // apply default topic pattern for non-top-level topics
-    if (!fullTopic.startsWith("/")) {
-      String pattern = value->getTopicPattern();
-      if (pattern == "")
-        pattern = DEFAULT_TOPIC_PATTERN;
-      pattern.replace("%s", fullTopic);
-      fullTopic = pattern;
+#endif
+    // format the payload only once because a function topic may return a different payload on the next call;
+    // the part of longer payloads that does not fit on the stack is kept on the heap
+    const String* cached = value->getCachedPayload();
+    String overflow;
+    __internal::PayloadBuffer buffer(cached == nullptr ? &overflow : nullptr);
+    if (cached != nullptr)
+      buffer.write((const uint8_t*)cached->c_str(), cached->length());
+    else {
+      value->printPayload(buffer);
+      if (!buffer.isComplete()) {
+        SIMPLEMQTT_ERROR(PSTR("Not enough memory for the payload of topic '%s'\n"), finalTopic);
+        return false;
+      }
     }
-    String payload = value->getPayload();
-    SIMPLEMQTT_DEBUG(PSTR("Publishing%s topic: '%s' (%s) with payload '%s'\n"), (value->isRetained() ? " retained" : ""), fullTopic.c_str(), value->getConfigStr().c_str(), payload.c_str());
-    return publish(fullTopic.c_str(), payload.c_str(), value->isRetained());
+    // after a reconnect skip topics whose payload has already been sent
+    if (syncPass == Pass::PUBLISH_ALL && !fullResync && !value->needsPublish() && buffer.hash() == value->publishedHash && !requiresAnnounce(value))
+      return true;
+    // skip duplicates of the last payload unless a request is answered
+    if (value->suppressDuplicates && !value->requested && buffer.hash() == value->publishedHash)
+      return true;
+#if SIMPLEMQTT_OFFLINE_BUFFER > 0
+    // keep the order of publishes while recorded publishes are pending
+    if (value->buffered && (!connected() || !offlineBuffer.isEmpty()))
+      return storeOffline(value, buffer);
+#endif
+    SIMPLEMQTT_DEBUG(PSTR("Publishing%s topic: '%s' (%s) with payload '%.*s%s'\n"), (value->isRetained() ? " retained" : ""), finalTopic, value->getConfigStr().c_str(),
+      (int)(cached != nullptr ? cached->length() : buffer.length() - overflow.length()), (cached != nullptr ? cached->c_str() : (const char*)buffer.data), overflow.c_str());
+    if (!beginPublish(finalTopic, buffer.length(), value->isRetained()))
+      return false;
+    if (cached != nullptr)
+      PubSubClient::write((const uint8_t*)cached->c_str(), cached->length());
+    else
+      buffer.writeTo(*static_cast<PubSubClient*>(this));
+    if (endPublish() == 0)
+      return false;
+    value->publishedHash = buffer.hash();
+    return true;
   };
 
   bool publish(__internal::_Topic& topic, const char* payload, bool retained = false) {
@@ -224,8 +804,8 @@ public:
   };
 
   State handle(State previousState) {
-    // initial connect attempt?
-    if (previousState == State::DISCONNECTED && !connected() && state() != MQTT_CONNECTION_LOST) {
+    // connect attempt?
+    if (previousState == State::DISCONNECTED && !connected()) {
       // checks
       if (mqttClientName[0] == '\0') {
         SIMPLEMQTT_ERROR(PSTR("SimpleMQTTClient name invalid\n"));
@@ -240,6 +820,14 @@ public:
         return State::INVALID_TOPIC;
       }
 
+      // wait until the backoff delay after a failed attempt has passed
+      if (connectScheduled && (int32_t)(millis() - nextConnect) < 0) {
+#if SIMPLEMQTT_OFFLINE_BUFFER > 0
+        recordOffline();
+#endif
+        return State::DISCONNECTED;
+      }
+
       // setup
       setServer(mqttHost, mqttPort);
       setCallback([this](char* topic, uint8_t* payload, unsigned int length) {
@@ -260,13 +848,20 @@ public:
       SIMPLEMQTT_DEBUG(PSTR("SimpleMQTTClient connecting...\n"));
       if (connect()) {
         SIMPLEMQTT_DEBUG(PSTR("SimpleMQTTClient connected\n"));
+        reconnectDelay = 0;
+        connectScheduled = false;
+        failedConnects = 0;
         loop();
         if (state() != MQTT_CONNECTED)
           return State::CONNECTING;
         else
           return State::RECONNECTED;
       } else {
-        SIMPLEMQTT_DEBUG(PSTR("SimpleMQTTClient disconnected\n"));
+        scheduleReconnect();
+        SIMPLEMQTT_DEBUG(PSTR("SimpleMQTTClient disconnected, next attempt in %u ms\n"), (unsigned int)getReconnectWait());
+#if SIMPLEMQTT_OFFLINE_BUFFER > 0
+        recordOffline();
+#endif
         return State::DISCONNECTED;
       }
     } else
@@ -277,38 +872,72 @@ public:
 
         if (previousState == State::RECONNECTED || (previousState == State::CONNECTING && state() == MQTT_CONNECTED)) {
           // performed once after initial connect
-          addSubscriptions(this);
-          // publish all values
-          MQTTGroup::publish(true);
+          buildIndex();
+          subscribedFilters.reset();
+#if SIMPLEMQTT_OFFLINE_BUFFER > 0
+          offlineRecording = true;
+#endif
+          // subscribe and publish all values, continued in the next calls if the time budget is exhausted
+          syncPass = Pass::SUBSCRIBE;
+          syncCursor.depth = 0;
+          publishCursor.depth = 0;
+          continueSync();
           if (previousState == State::RECONNECTED)
             return State::CONNECTED;
           else
             return State::RECONNECTED;
         }
+        if (!continueSync())
+          return State::CONNECTED;
+#if SIMPLEMQTT_OFFLINE_BUFFER > 0
+        drainOffline();
+#endif
         if (mqttWill != nullptr && mqttWill->needsPublish())
           mqttWill->publish();
 
+        // request publishes of topics whose publish interval has passed
+        __internal::PublishTimer* timer = timerWheel.expire(millis());
+        while (timer != nullptr) {
+          __internal::PublishTimer* next = timer->next;
+          timer->next = nullptr;
+          timer->deferred = false;
+          timer->topic->requestPublish();
+          timer = next;
+        }
+
         // recursively check registered topics
-        check();
+        continueCheck();
+        // notify changes
+        if (changeCallback != nullptr) {
+          MQTTTopic* value;
+          while ((value = getChange()) != nullptr)
+            changeCallback(*value);
+        }
         // publish changed topics
-        MQTTGroup::publish();
+        if (publishCursor.depth > 0 || needsPublish()) {
+          continuePass(publishCursor, Pass::PUBLISH);
+        }
         if (statusTopic != nullptr && statusTopic->needsPublish())
           statusTopic->publish();
       }
+#if SIMPLEMQTT_OFFLINE_BUFFER > 0
+      else
+        recordOffline();
+#endif
 
     return state() == MQTT_CONNECTED ? State::CONNECTED : State::DISCONNECTED;
   };
 
   State handle() {
+    handleStart = micros();
     previousState = handle(previousState);
     return previousState;
   };
 
   bool payloadReceived(char* topic, uint8_t* payload, unsigned int length) {
-    char* p = (char*)alloca(length + 1);
-    memcpy(p, payload, length);
-    p[length] = '\0';
-    SIMPLEMQTT_DEBUG(PSTR("Received topic: '%s' with payload '%s'\n"), topic, p);
+    // the payload is processed in the receive buffer of the PubSubClient without copying it
+    std::string_view p((const char*)payload, length);
+    SIMPLEMQTT_DEBUG(PSTR("Received topic: '%s' with payload '%.*s'\n"), topic, (int)length, (const char*)payload);
 
     return processPayload(this, topic, p);
   };
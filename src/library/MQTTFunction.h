@@ -48,9 +48,7 @@ friend class MQTTGroup;
 
 protected:
   typedef ResultCode (*PayloadHandler)(MQTTSetFunction<T>& object, const char* payload);
-  PayloadHandler payloadHandler = [](MQTTSetFunction<T>& object, const char* payload) {
-    return object.setFromPayload(payload);
-  };
+  PayloadHandler payloadHandler = nullptr;  // setFromPayload() is used if not set
   typedef void (*SetFunction)(T);
   SetFunction setFunction;
 
@@ -71,12 +69,12 @@ protected:
     setFunction(newValue);
   };
 
-  ResultCode setReceived(const char* payload) override {
+  ResultCode setReceived(std::string_view payload) override {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
     if (MQTTTopic::isAutoPublish())
       MQTTTopic::republish();
     if (payloadHandler != nullptr)
-      return payloadHandler(*this, payload);
+      return payloadHandler(*this, __internal::payloadToString(payload).c_str());
     return setFromPayload(payload);
   };
 
@@ -113,13 +111,13 @@ public:
 
   // Attempts to parse the payload and sets the newValue variable.
   // For use by custom implementations of payload handlers.
-  bool parseValue(const char* str, T* newValue) {
+  bool parseValue(std::string_view str, T* newValue) {
     return __internal::parseValue(str, newValue, MQTTFormattedTopic<T>::format);
   };
 
   // Attempts to set this topic's value from the supplied payload string.
   // Returns a ResultCode that indicates success or the reason of failure.
-  ResultCode setFromPayload(const char* payload) override {
+  ResultCode setFromPayload(std::string_view payload) override {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
     SIMPLEMQTT_DEBUG_SET_FROM_PAYLOAD;
     T newValue;
@@ -157,9 +155,7 @@ protected:
   GetFunction getFunction;
 
   typedef ResultCode (*PayloadHandler)(MQTTGetSetFunction<T>& object, const char* payload);
-  PayloadHandler payloadHandler = [](MQTTGetSetFunction<T>& object, const char* payload) {
-    return object.setFromPayload(payload);
-  };
+  PayloadHandler payloadHandler = nullptr;  // setFromPayload() is used if not set
   typedef void (*SetFunction)(T);
   SetFunction setFunction;
 
@@ -175,12 +171,12 @@ protected:
     setFunction(newValue);
   };
 
-  ResultCode setReceived(const char* payload) override {
+  ResultCode setReceived(std::string_view payload) override {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
     if (MQTTTopic::isAutoPublish())
       MQTTTopic::republish();
     if (payloadHandler != nullptr)
-      return payloadHandler(*this, payload);
+      return payloadHandler(*this, __internal::payloadToString(payload).c_str());
     return setFromPayload(payload);
   };
 
@@ -214,13 +210,13 @@ public:
 
   // Attempts to parse the payload and sets the newValue variable.
   // For use by custom implementations of payload handlers.
-  bool parseValue(const char* str, T* newValue) {
+  bool parseValue(std::string_view str, T* newValue) {
     return __internal::parseValue(str, newValue, MQTTFormattedTopic<T>::format);
   };
 
   // Attempts to set this topic's value from the supplied payload string.
   // Returns a ResultCode that indicates success or the reason of failure.
-  ResultCode setFromPayload(const char* payload) override {
+  ResultCode setFromPayload(std::string_view payload) override {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
     SIMPLEMQTT_DEBUG_SET_FROM_PAYLOAD;
     T newValue;
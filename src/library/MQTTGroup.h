@@ -12,12 +12,9 @@ class MQTTGroup : public MQTTTopic {
   friend class SimpleMQTTClient;
 
 protected:
-  typedef struct ListNode {
-    MQTTTopic* data;
-    ListNode* next;
-  } ListNode;
-
-  ListNode nodes{ nullptr, nullptr };
+  MQTTTopic** children = nullptr;  // subtopics in the order they have been added
+  uint16_t childCount = 0;
+  uint16_t childCapacity = 0;
   TopicOrder topicOrder = TopicOrder::UNSPECIFIED;
   String topicPattern;
   String requestPattern;
@@ -26,10 +23,36 @@ protected:
   MQTTGroup(MQTTGroup* aParent, __internal::_Topic aTopic, uint8_t aConfig)
     : MQTTTopic(aParent, aTopic, aConfig){};
 
+  ~MQTTGroup() {
+    SIMPLEMQTT_DEALLOCATE_MEM(children, childCapacity * sizeof(MQTTTopic*));
+  };
+
+  // Makes room for one more subtopic. The capacity of the children array is doubled when it is full.
+  bool reserveChild() {
+    if (childCount < childCapacity)
+      return true;
+    if (childCapacity >= UINT16_MAX / 2)
+      return false;
+    uint16_t capacity = (childCapacity == 0 ? 2 : childCapacity * 2);
+    MQTTTopic** newChildren = SIMPLEMQTT_ALLOCATE_MEM(MQTTTopic*, capacity * sizeof(MQTTTopic*));
+    if (newChildren == nullptr)
+      return false;
+    if (childCount > 0)
+      memcpy(newChildren, children, childCount * sizeof(MQTTTopic*));
+    SIMPLEMQTT_DEALLOCATE_MEM(children, childCapacity * sizeof(MQTTTopic*));
+    children = newChildren;
+    childCapacity = capacity;
+    return true;
+  };
+
   inline String type() const override {
     return String("+");
   };
 
+  MQTTGroup* asGroup() override {
+    return this;
+  };
+
   String getTopicPattern() override {
     String result;
     if (_parent != nullptr)
@@ -52,6 +75,15 @@ protected:
     return result;
   };
 
+  // Returns the request pattern as a pointer to avoid the creation of a String.
+  const char* requestPatternStr() {
+    if (_parent != nullptr)
+      return _parent->requestPatternStr();
+    if (requestPattern == "")
+      return DEFAULT_REQUEST_PATTERN.c_str();
+    return requestPattern.c_str();
+  };
+
   virtual String applyRequestPattern(MQTTTopic* value) {
     String result = getRequestPattern();
     result.replace("%s", value->getFullTopic(getTopicOrder()));
@@ -97,55 +129,53 @@ protected:
       return false;
     }
 
-    ListNode* node = &nodes;
-    while (node->next != nullptr) {
-      // cannot add if an existing node already has the same topic
-      if (node->data->getFullTopic() == value->getFullTopic()) {
+    // the name is cached for the index and the publishes
+    const char* name = value->fullTopicStr();
+    if (name[0] == '\0') {
+      SIMPLEMQTT_ERROR(PSTR("Not enough memory for the name of element '%s'\n"), value->getFullTopic().c_str());
+      return false;
+    }
+    for (uint16_t i = 0; i < childCount; i++) {
+      // cannot add if an existing child already has the same topic
+      if (strcmp(children[i]->fullTopicStr(), name) == 0) {
         SIMPLEMQTT_ERROR(PSTR("A topic '%s' has already been added\n"), value->getFullTopic().c_str());
         return false;
       }
-      node = node->next;
     }
-    node->data = value;
-    node->next = SIMPLEMQTT_ALLOCATE(ListNode);
-    if (node->next == __internal::INVALID_PTR) {
+    if (!reserveChild()) {
       SIMPLEMQTT_ERROR(PSTR("Not enough memory for internal list, element '%s'\n"), value->getFullTopic().c_str());
-      node->data = nullptr;
-      node->next = nullptr;
       return false;
     }
+    children[childCount++] = value;
+    // subtopics inherit the publish intervals, the offline buffering and the watch flag of the group
+    __internal::PublishTimer* timer = publishTimer();
+    if (timer != nullptr)
+      value->applyPublishInterval(timer->minInterval, timer->maxInterval);
+    if (buffered)
+      value->applyBuffered(true);
+    if (watched)
+      value->applyWatched(true);
     if (value->isAutoPublish())
       value->republish();
+    __internal::treeVersion++;
     return true;
   };
 
   void publish(bool all = false) override {
     SIMPLEMQTT_CHECK_VALID();
-    const ListNode* node = &nodes;
-    while (node->next != nullptr) {
-      MQTTTopic* value = node->data;
+    // clear the flag first; subtopics that are republished during this pass set it again
+    config &= PUBLISH_CLEARMASK;
+    for (uint16_t i = 0; i < childCount; i++) {
+      MQTTTopic* value = children[i];
       if (all || value->needsPublish())
         value->publish(all);
-      node = node->next;
     }
-    config &= PUBLISH_CLEARMASK;
   };
 
+  // The publish flag of a group is set when one of its subtopics needs to be published
+  // (see MQTTTopic::republish()), so clean subtrees are skipped without visiting them.
   bool needsPublish() const override {
-    SIMPLEMQTT_CHECK_VALID(false);
-    bool result = ((config >> PUBLISH_BIT) & 1) == 1;
-    if (result)
-      return true;
-    const ListNode* node = &nodes;
-    while (node->next != nullptr) {
-      MQTTTopic* value = node->data;
-      if (value->needsPublish()) {
-        //        SIMPLEMQTT_DEBUG(PSTR("Needs publish: '%s', config: %s\n"), value->getFullTopic().c_str(), value->getConfigStr());
-        return true;
-      }
-      node = node->next;
-    }
-    return false;
+    return MQTTTopic::needsPublish();
   };
 
   template<typename T>
@@ -160,18 +190,19 @@ protected:
     SIMPLEMQTT_CHECK_VALID(false);
     if (!MQTTTopic::check())
       return false;
-    // recursively check subtopics
-    ListNode* node = &nodes;
-    while (node->next != nullptr) {
-      node->data->check();
-      node = node->next;
+    // recursively check subtopics; variables in the watch region are checked by the client
+    for (uint16_t i = 0; i < childCount; i++) {
+      if (!children[i]->inWatchRegion && children[i]->isCheckDue())
+        children[i]->check();
     }
     return true;
   };
 
   virtual void addSubscriptions(SimpleMQTTClient* client) override;
 
-  virtual bool processPayload(SimpleMQTTClient* client, const char* topic, const char* payload) override;
+  virtual void addToIndex(SimpleMQTTClient* client, __internal::TopicIndex& index) override;
+
+  virtual bool processPayload(SimpleMQTTClient* client, const char* topic, std::string_view payload) override;
 
 public:
   SIMPLEMQTT_OVERRIDE_SETTERS(MQTTGroup)
@@ -194,6 +225,8 @@ public:
   // The topic order determines how the full path of a topic is calculated.
   virtual MQTTGroup& setTopicOrder(TopicOrder order) {
     topicOrder = order;
+    __internal::treeVersion++;
+    __internal::pathVersion++;
     return *this;
   };
 
@@ -201,6 +234,8 @@ public:
   // The string %s in the pattern is replaced by a topic's full path in the topic hierarchy.
   virtual MQTTGroup& setTopicPattern(const String& pattern) {
     topicPattern = pattern;
+    __internal::treeVersion++;
+    __internal::pathVersion++;
     return *this;
   };
 
@@ -208,6 +243,7 @@ public:
   // The string %s in the pattern is replaced by a topic's full path in the topic hierarchy.
   virtual MQTTGroup& setRequestPattern(const String& pattern) {
     requestPattern = pattern;
+    __internal::treeVersion++;
     return *this;
   };
 
@@ -215,6 +251,7 @@ public:
   // The string %s in the pattern is replaced by a topic's full path in the topic hierarchy.
   virtual MQTTGroup& setSetPattern(const String& pattern) {
     setPattern = pattern;
+    __internal::treeVersion++;
     return *this;
   };
 
@@ -224,11 +261,40 @@ public:
     SIMPLEMQTT_CHECK_VALID();
     if (!MQTTTopic::isTopicValid())
       return;
-    ListNode* node = &nodes;
-    while (node->next != nullptr) {
-      node->data->republish();
-      node = node->next;
-    }
+    for (uint16_t i = 0; i < childCount; i++)
+      children[i]->republish();
+  };
+
+  // A request for a group is answered by all of its subtopics, including those whose payload has not changed.
+  ResultCode requestReceived(std::string_view payload) override {
+    SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
+    for (uint16_t i = 0; i < childCount; i++)
+      children[i]->requestReceived(payload);
+    return ResultCode::OK;
+  };
+
+  void applyPublishInterval(uint32_t minInterval, uint32_t maxInterval) override {
+    // the group's own timer only holds the settings for subtopics that are added later
+    MQTTTopic::applyPublishInterval(minInterval, maxInterval);
+    for (uint16_t i = 0; i < childCount; i++)
+      children[i]->applyPublishInterval(minInterval, maxInterval);
+  };
+
+  void applyBuffered(bool aBuffered) override {
+    MQTTTopic::applyBuffered(aBuffered);
+    for (uint16_t i = 0; i < childCount; i++)
+      children[i]->applyBuffered(aBuffered);
+  };
+
+  void applyWatched(bool aWatched) override {
+    MQTTTopic::applyWatched(aWatched);
+    for (uint16_t i = 0; i < childCount; i++)
+      children[i]->applyWatched(aWatched);
+  };
+
+  void addToWatchRegion(__internal::WatchRegion& region) override {
+    for (uint16_t i = 0; i < childCount; i++)
+      children[i]->addToWatchRegion(region);
   };
 
   // helper templates to allow passing macro arguments with commas in brackets
@@ -283,7 +349,7 @@ public:
   typename std::enable_if_t<NOT_FUNDAMENTAL && NOT_CONST && NOT_POINTER && NOT_ARRAY, typename mqtt_value_type<T>::type> add(__internal::_Topic topic, V initialValue) {
     typename mqtt_value_type<T>::type result = add<T>(topic);
     if (result.name()[0] != '\0')
-      result = initialValue;
+      result = std::move(initialValue);
     return result;
   };
 
@@ -348,6 +414,13 @@ public:
   // Adds a new string topic from the given string constant. The value is not settable.
   MQTTConstCharArray& add(__internal::_Topic topic, const char* s);
 
+  // Adds a new string topic that holds up to N - 1 characters in an inline buffer without using the heap.
+  // Longer values are truncated.
+  template<size_t N>
+  typename std::enable_if_t<(N > 1), typename mqtt_fixedstring_type<N>::type> addFixedString(__internal::_Topic topic) {
+    SIMPLEMQTT_ADD_BODY((typename mqtt_fixedstring_type<N>::type), (MQTTFixedString<N>), this, topic, getConfig());
+  };
+
   // Adds a new Get function topic. The function is called when the topic is published or its value() function is called.
   template<typename T>
   typename std::enable_if_t<true, typename mqtt_getfunction_type<T>::type> add(__internal::_Topic topic, T (*getFunction)(void)) {
@@ -379,13 +452,7 @@ public:
   // Returns the number of child topics in this group.
   const size_t size() const {
     SIMPLEMQTT_CHECK_VALID(0);
-    const ListNode* node = &nodes;
-    size_t c = 0;
-    while (node->next != nullptr) {
-      c++;
-      node = node->next;
-    }
-    return c;
+    return childCount;
   };
 
   // Returns a subtopic by name or path
@@ -400,11 +467,9 @@ public:
       part = part.substring(0, i);
       rest = key.substring(i + 1);
     }
-    const ListNode* node = &nodes;
-    while (node->next != nullptr) {
-      if (part.equals(node->data->name()))
-        return node->data->get(rest, autoCreate);
-      node = node->next;
+    for (uint16_t i = 0; i < childCount; i++) {
+      if (part.equals(children[i]->name()))
+        return children[i]->get(rest, autoCreate);
     }
     // not found; create?
     if (autoCreate) {
@@ -431,14 +496,9 @@ public:
   // Returns the subtopic at position i. Returns the invalid topic if the index is out of bounds.
   MQTTTopic& get(size_t i) {
     SIMPLEMQTT_CHECK_VALID(MQTTTopic::INVALID_TOPIC);
-    const ListNode* node = &nodes;
-    size_t c = 0;
-    while (node->next != nullptr) {
-      if (i == c++)
-        return *node->data;
-      node = node->next;
-    }
-    return MQTTTopic::INVALID_TOPIC;
+    if (i >= childCount)
+      return MQTTTopic::INVALID_TOPIC;
+    return *children[i];
   };
 
   // Returns the subtopic at position i. Returns the invalid topic if the index is out of bounds.
@@ -448,11 +508,9 @@ public:
 
   bool hasBeenChanged(bool b) const override {
     SIMPLEMQTT_CHECK_VALID(false);
-    const ListNode* node = &nodes;
-    while (node->next != nullptr) {
-      if (node->data->hasBeenChanged(b))
+    for (uint16_t i = 0; i < childCount; i++) {
+      if (children[i]->hasBeenChanged(b))
         return true;
-      node = node->next;
     }
     return false;
   };
@@ -460,11 +518,9 @@ public:
   // Returns the first subtopic that has been changed (depth-first) or nullptr if there are no changed subtopics.
   MQTTTopic* getChange() override {
     SIMPLEMQTT_CHECK_VALID(nullptr);
-    ListNode* node = &nodes;
-    while (node->next != nullptr) {
-      if (node->data->hasBeenChanged(false))
-        return node->data->getChange();
-      node = node->next;
+    for (uint16_t i = 0; i < childCount; i++) {
+      if (children[i]->hasBeenChanged(false))
+        return children[i]->getChange();
     }
     return nullptr;
   };
@@ -482,11 +538,8 @@ public:
       n += p.print(" (");
       n += p.print(getConfigStr());
       n += p.println("): {");
-      const ListNode* node = &nodes;
-      while (node->next != nullptr) {
-        n += node->data->printTo(p, indent + 2);
-        node = node->next;
-      }
+      for (uint16_t i = 0; i < childCount; i++)
+        n += children[i]->printTo(p, indent + 2);
       for (size_t i = 0; i < indent; i++)
         n += p.print(" ");
       n += p.print("} (");
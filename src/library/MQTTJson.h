@@ -17,9 +17,11 @@ protected:
   MQTTJsonTopic(MQTTGroup* aParent, __internal::_Topic aTopic, uint8_t aConfig, JsonDocument* aFilter)
     : MQTTTopic(aParent, aTopic, aConfig), filter(aFilter) {};
 
-  static ResultCode _deserialize(JsonDocument& newDoc, const char* payload, JsonDocument* filter = nullptr) {
+  // The payload is passed as const char* so that ArduinoJson copies the strings out of it.
+  static ResultCode _deserialize(JsonDocument& newDoc, std::string_view payload, JsonDocument* filter = nullptr) {
+    const char* input = payload.data();
     DeserializationError err = (filter == nullptr 
-      ? deserializeJson(newDoc, payload) : deserializeJson(newDoc, payload, DeserializationOption::Filter(*filter)));
+      ? deserializeJson(newDoc, input, payload.length()) : deserializeJson(newDoc, input, payload.length(), DeserializationOption::Filter(*filter)));
     switch (err.code()) {
       case DeserializationError::EmptyInput: return ResultCode::INVALID_PAYLOAD;
       case DeserializationError::IncompleteInput: return ResultCode::OUT_OF_MEMORY;
@@ -35,13 +37,14 @@ protected:
     SIMPLEMQTT_CHECK_VALID(false);
     bool changed = jdoc != newDoc;
     jdoc = newDoc;
+    MQTTTopic::invalidatePayload();
     if (MQTTTopic::isAutoPublish())
       MQTTTopic::republish();
     MQTTTopic::setChanged(MQTTTopic::hasBeenChanged(false) || changed);
     return changed;
   };
 
-  ResultCode setReceived(const char* payload) override {
+  ResultCode setReceived(std::string_view payload) override {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
     return setFromPayload(payload);
   };
@@ -49,32 +52,34 @@ protected:
 public:
   SIMPLEMQTT_OVERRIDE_SETTERS(MQTTJsonTopic)
 
+  // Access to the document discards the cached payload as the document may be modified.
   virtual JsonDocument& doc() {
+    MQTTTopic::invalidatePayload();
     return jdoc;
   };
 
   // JsonDocument delegate functions >>>>>
-  auto operator[](size_t index) { return jdoc[index]; };
-  auto operator[](const char* key) { return jdoc[key]; };
-  auto operator[](char* key) { return jdoc[key]; };
-  auto operator[](const String& key) { return jdoc[key]; };
-  auto operator[](const std::string& key) { return jdoc[key]; };
-  auto operator[](const __FlashStringHelper* key) { return jdoc[key]; };
-  auto operator[](std::string_view key) { return jdoc[key]; };
+  auto operator[](size_t index) { return doc()[index]; };
+  auto operator[](const char* key) { return doc()[key]; };
+  auto operator[](char* key) { return doc()[key]; };
+  auto operator[](const String& key) { return doc()[key]; };
+  auto operator[](const std::string& key) { return doc()[key]; };
+  auto operator[](const __FlashStringHelper* key) { return doc()[key]; };
+  auto operator[](std::string_view key) { return doc()[key]; };
   auto add() {
-    return jdoc.add();
+    return doc().add();
   };
   template <typename TValue>
   auto add(const TValue& value) {
-    return jdoc.add(value);
+    return doc().add(value);
   };
   template <typename TChar>
   auto add(TChar* value) {
-    return jdoc.add(value);
+    return doc().add(value);
   };
   template <typename T>
   auto to() {
-    return jdoc.to<T>();
+    return doc().template to<T>();
   };
   // <<<<< JsonDocument delegate functions
 
@@ -85,7 +90,12 @@ public:
     return json;
   };
 
-  ResultCode setFromPayload(const char* payload) override {
+  size_t printPayload(Print& p) const override {
+    SIMPLEMQTT_CHECK_VALID(0);
+    return serializeJson(jdoc, p);
+  };
+
+  ResultCode setFromPayload(std::string_view payload) override {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
     SIMPLEMQTT_DEBUG_SET_FROM_PAYLOAD;
 
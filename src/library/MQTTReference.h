@@ -12,9 +12,7 @@ friend class MQTTGroup;
 
 protected:
   typedef ResultCode (*PayloadHandler)(MQTTReference<T>& object, const char* payload);
-  PayloadHandler payloadHandler = [](MQTTReference<T>& object, const char* payload) {
-    return object.setFromPayload(payload);
-  };
+  PayloadHandler payloadHandler = nullptr;  // setFromPayload() is used if not set
   T& valueRef;
 
   MQTTReference(MQTTGroup* aParent, __internal::_Topic aTopic, uint8_t aConfig, T& aValue)
@@ -30,10 +28,13 @@ protected:
     return String("&"); 
   };
 
-  void _setValue(T newValue) override {
-    SIMPLEMQTT_CHECK_VALID();
-    if constexpr (!std::is_const_v<T>)
-      valueRef = newValue;
+  T& _valueRef() override {
+    return valueRef;
+  };
+
+  void addToWatchRegion(__internal::WatchRegion& region) override {
+    if constexpr (!std::is_const_v<T> && std::is_trivially_copyable_v<T>)
+      MQTTTopic::inWatchRegion = MQTTTopic::watched && MQTTTopic::isTopicValid() && region.add(this, &valueRef, sizeof(T));
   };
 
   bool check() override {
@@ -44,7 +45,8 @@ protected:
       // detect underlying value change
       if (!this->_isEqual(MQTTValue<T>::_value)) {
         MQTTValue<T>::_value = valueRef;
-        if (MQTTValue<T>::isAutoPublish())
+        MQTTTopic::invalidatePayload();
+        if (MQTTValue<T>::isAutoPublish() && this->isPublishDue(valueRef))
           MQTTValue<T>::republish();
       }
     }
@@ -79,6 +81,13 @@ public:
     return *this;
   };
 
+  template<typename U = T, typename std::enable_if<!std::is_const_v<U>, bool>::type* = nullptr> // only for non-const types
+  inline MQTTReference<T>& operator=(T&& newValue) {
+    SIMPLEMQTT_CHECK_VALID(*this);
+    MQTTValue<T>::set(std::move(newValue));
+    return *this;
+  };
+
   // Sets the current value of this topic.
   // Checks whether the new value is different from the current value
   // and sets the Changed flag on the topic if this is the case.
@@ -96,7 +105,12 @@ public:
     return s;
   };
 
-  ResultCode setFromPayload(const char* payload) override {
+  size_t printPayload(Print& p) const override {
+    SIMPLEMQTT_CHECK_VALID(0);
+    return __internal::printValue(p, valueRef, MQTTValue<T>::format);
+  };
+
+  ResultCode setFromPayload(std::string_view payload) override {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
     return ResultCode::CANNOT_SET;
   };
@@ -121,10 +135,9 @@ struct mqtt_reference_type { typedef MQTTReference<T>& type; };
 /////////////////////////////////////////////////////////////////////
 
 template<>
-ResultCode MQTTReference<String>::setFromPayload(const char* payload) {
+ResultCode MQTTReference<String>::setFromPayload(std::string_view payload) {
   SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
   SIMPLEMQTT_DEBUG_SET_FROM_PAYLOAD;
-  String newValue = String(payload);
-  _set(newValue);
+  _set(payload);
   return ResultCode::OK;
 };
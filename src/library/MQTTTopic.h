@@ -5,6 +5,21 @@
 // https://github.com/leomeyer/SimpleMQTT
 /////////////////////////////////////////////////////////////////////
 
+namespace __internal {
+
+  // Rarely used settings of a topic. Allocated when the first of them is set and kept afterwards.
+  struct TopicOptions {
+    PublishTimer publishTimer;  // in use if a publish interval is set
+    CheckTimer checkTimer;      // in use if a check interval is set
+    PayloadCache payloadCache;  // in use if enabled
+  };
+
+  // Settings of formatted topics; arithmetic types add the state of the publish policy.
+  template<typename T>
+  struct FormattedTopicOptions : TopicOptions, PublishPolicyState<T> {};
+
+}  // namespace __internal
+
 // Base class for SimpleMQTT topics.
 class MQTTTopic
 #ifdef SIMPLEMQTT_TOPICS_PRINTABLE
@@ -26,13 +41,25 @@ protected:
                    // |   | + changed by set message
                    // |   + publish required
                    // + retained
+  bool buffered : 1;      // publishes are recorded in the offline buffer while disconnected
+  bool mustAnnounce : 1;  // published after each reconnect even if the payload is unchanged
+  bool suppressDuplicates : 1;  // publishes of an unchanged payload are skipped
+  bool requested : 1;     // a request is waiting to be answered by a publish
+  bool watched : 1;       // the variable is to be compared in bulk by the client's watch region
+  bool inWatchRegion : 1; // the variable is part of the watch region and not checked individually
+  uint16_t cachedVersion = 0;
+  const char* cachedFullTopic = nullptr;   // full topic name, stored in the topic arena
+  const char* cachedFinalTopic = nullptr;  // topic name to publish to, may point into cachedFullTopic
+  MQTTTopic* nextChange = nullptr;         // next topic in the client's change queue
+  uint32_t publishedHash = 0;              // hash of the last payload sent to the broker, 0 if none
+  __internal::TopicOptions* options = nullptr;  // only allocated if one of the rarely used settings is made
 
   // prohibit default copy semantics, forcing the user to work with references or pointers
   MQTTTopic(const MQTTTopic&) = delete;
   void operator=(const MQTTTopic&) = delete;
 
   MQTTTopic(MQTTGroup* aParent, __internal::_Topic aTopic, uint8_t aConfig)
-    : _parent(aParent), topic(aTopic), config(aConfig) {
+    : _parent(aParent), topic(aTopic), config(aConfig), buffered(false), mustAnnounce(false), suppressDuplicates(false), requested(false), watched(false), inWatchRegion(false) {
       // topics that start with a slash (top level topics) are by default not requestable and not auto-publishing
       if (name()[0] == '/') {
         setRequestable(false);
@@ -40,11 +67,17 @@ protected:
       }
     };
 
+  virtual ~MQTTTopic() {};
+
   virtual inline String type() const { return String(); };
 
+  // Returns this topic as a group if it is one, nullptr otherwise.
+  virtual MQTTGroup* asGroup() { return nullptr; };
+
+  // Returns the configuration of this topic without the publish and changed state flags.
   inline uint8_t getConfig() {
     SIMPLEMQTT_CHECK_VALID(0);
-    return config;
+    return config & PUBLISH_CLEARMASK & CHANGED_CLEARMASK;
   };
 
   String getConfigStr() const {
@@ -71,13 +104,15 @@ protected:
 
   virtual String getTopicPattern();
 
-  virtual ResultCode requestReceived(const char*) {
+  // Requests are answered on the next handle() call regardless of the minimum publish interval.
+  virtual ResultCode requestReceived(std::string_view) {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
-    republish();
+    requested = true;
+    requestPublish();
     return ResultCode::OK;
   };
 
-  virtual ResultCode setReceived(const char*) {
+  virtual ResultCode setReceived(std::string_view) {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
     if (isAutoPublish())
       republish();
@@ -88,9 +123,71 @@ protected:
     SIMPLEMQTT_CHECK_VALID(*this);
     config &= CHANGED_CLEARMASK;
     config |= (changed ? CHANGED_SETMASK : 0);
+    if (changed)
+      queueChange();
     return *this;
   };
 
+  // Appends this topic to the client's change queue if it is not already queued.
+  void queueChange(); // see MQTTImpl.h
+
+  // Sets the publish flag on this topic and its parent groups regardless of the publish intervals.
+  void requestPublish(); // see MQTTImpl.h
+
+  // Allocates the block of rarely used settings. Formatted topics extend it by the state of the publish policy.
+  virtual __internal::TopicOptions* allocateOptions() {
+    return SIMPLEMQTT_ALLOCATE(__internal::TopicOptions);
+  };
+
+  // Returns the block of rarely used settings, allocating it on first use; nullptr if out of memory.
+  __internal::TopicOptions* getOptions() {
+    if (options == nullptr) {
+      __internal::TopicOptions* allocated = allocateOptions();
+      if (allocated == __internal::INVALID_PTR)
+        return nullptr;
+      options = allocated;
+    }
+    return options;
+  };
+
+  // Returns the publish timer if publish intervals are set, nullptr otherwise.
+  __internal::PublishTimer* publishTimer() const {
+    if (options == nullptr || (options->publishTimer.minInterval == 0 && options->publishTimer.maxInterval == 0))
+      return nullptr;
+    return &options->publishTimer;
+  };
+
+  // Returns the payload cache if it is enabled, nullptr otherwise.
+  __internal::PayloadCache* payloadCache() const {
+    return (options != nullptr && options->payloadCache.enabled ? &options->payloadCache : nullptr);
+  };
+
+  // Sets the publish intervals of this topic; groups also apply them to their subtopics.
+  virtual void applyPublishInterval(uint32_t minInterval, uint32_t maxInterval); // see MQTTImpl.h
+
+  // Sets the offline buffering flag of this topic; groups also apply it to their subtopics.
+  virtual void applyBuffered(bool aBuffered) {
+    buffered = aBuffered;
+  };
+
+  // Returns whether the check interval of this topic has passed and restarts it if so.
+  bool isCheckDue() {
+    if (options == nullptr || options->checkTimer.interval == 0)
+      return true;
+    uint32_t now = millis();
+    if (now - options->checkTimer.lastCheck < options->checkTimer.interval)
+      return false;
+    options->checkTimer.lastCheck = now;
+    return true;
+  };
+
+  // Sets the watch flag of this topic; groups also apply it to their subtopics.
+  virtual void applyWatched(bool aWatched) {
+    watched = aWatched;
+    if (!aWatched)
+      inWatchRegion = false;
+  };
+
   void releaseTopic() {
     topic.release();
   }
@@ -113,9 +210,39 @@ protected:
   
   virtual void publish(bool all = false);
 
+  // Called after the payload of this topic has been published successfully.
+  virtual void payloadPublished() {};
+
   virtual void addSubscriptions(SimpleMQTTClient* client);
 
-  virtual bool processPayload(SimpleMQTTClient* client, const char* topic, const char* payload);
+  // Returns the given final request or set topic of this topic with the levels of the full topic
+  // below the client's topic replaced by single-level wildcards. Returns an empty string if the topic
+  // is not located below the client's topic or if the final topic does not contain the full topic.
+  String getWildcardTopic(const char* topic, __internal::TopicIndex::Kind kind);
+
+  virtual void addToIndex(SimpleMQTTClient* client, __internal::TopicIndex& index);
+
+  // Adds the variable of this topic to the watch region if the topic is watched.
+  virtual void addToWatchRegion(__internal::WatchRegion&) {};
+
+  // Computes the full and the final topic names and stores them in the topic arena.
+  void updateTopicCache();
+
+  // Returns the cached name of the topic that this topic is published to.
+  // The topic pattern has been applied to this name.
+  const char* finalTopicStr() {
+    SIMPLEMQTT_CHECK_VALID(__internal::EMPTY);
+    if (cachedFinalTopic == nullptr || cachedVersion != __internal::pathVersion)
+      updateTopicCache();
+    return cachedFinalTopic;
+  };
+
+  // The payload is not terminated; it refers to the client's receive buffer.
+  virtual bool processPayload(SimpleMQTTClient* client, const char* topic, std::string_view payload);
+
+  bool processRequest(SimpleMQTTClient* client, const char* topic, std::string_view payload);
+
+  bool processSet(SimpleMQTTClient* client, const char* topic, std::string_view payload);
 
 public:
   static MQTTTopic INVALID_TOPIC;
@@ -195,6 +322,7 @@ public:
     SIMPLEMQTT_CHECK_VALID(*this);
     config &= REQUESTABLE_CLEARMASK;
     config |= (requestable ? REQUESTABLE_SETMASK : 0);
+    __internal::treeVersion++;
     return *this;
   };
 
@@ -215,6 +343,7 @@ public:
     SIMPLEMQTT_CHECK_VALID(*this);
     config &= SETTABLE_CLEARMASK;
     config |= (settable ? SETTABLE_SETMASK : 0);
+    __internal::treeVersion++;
     return *this;
   };
 
@@ -230,7 +359,7 @@ public:
 
   // Attempts to set this topic's value from the supplied payload string.
   // Returns a ResultCode that indicates success or the reason of failure.
-  virtual ResultCode setFromPayload(const char* payload) {
+  virtual ResultCode setFromPayload(std::string_view payload) {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
     SIMPLEMQTT_DEBUG_SET_FROM_PAYLOAD;
     return ResultCode::CANNOT_SET;
@@ -241,12 +370,115 @@ public:
     return String();
   };
 
+  // Writes the current value of this topic to the specified Print object.
+  // Returns the number of bytes written.
+  virtual size_t printPayload(Print& p) const {
+    return p.print(getPayload());
+  };
+
   // Sets a flag that indicates that this topic should be published to the broker
   // on the next call of the handle() function.
-  virtual void republish() {
-    SIMPLEMQTT_CHECK_VALID();
-    // set flag to re-publish
-    config |= PUBLISH_SETMASK;
+  virtual void republish(); // see MQTTImpl.h
+
+  // Sets the minimum and maximum time between two publishes of this topic in milliseconds.
+  // Changes within the minimum interval after a publish are published together when the interval
+  // has passed. If the topic has not been published for the maximum interval it is published again.
+  // A value of 0 disables the respective interval. If set on a group the intervals apply to all
+  // current subtopics and to subtopics that are added later.
+  virtual MQTTTopic& setPublishInterval(uint32_t minInterval, uint32_t maxInterval = 0); // see MQTTImpl.h
+
+  // Sets whether publishes of this topic are recorded while the client is disconnected
+  // and sent after the connection has been reestablished. Setting this on a group applies it to its subtopics.
+  // Has no effect unless SIMPLEMQTT_OFFLINE_BUFFER is greater than 0.
+  virtual MQTTTopic& setBuffered(bool aBuffered) {
+    SIMPLEMQTT_CHECK_VALID(*this);
+    applyBuffered(aBuffered);
+    return *this;
+  };
+
+  // Returns whether publishes of this topic are recorded while the client is disconnected.
+  virtual bool isBuffered() const {
+    SIMPLEMQTT_CHECK_VALID(false);
+    return buffered;
+  };
+
+  // Sets whether this topic is published after each reconnect even if its payload has already been
+  // published with the same content. Setting this on a group applies it to its subtopics.
+  virtual MQTTTopic& setMustAnnounce(bool aMustAnnounce) {
+    SIMPLEMQTT_CHECK_VALID(*this);
+    mustAnnounce = aMustAnnounce;
+    return *this;
+  };
+
+  // Returns whether this topic is published after each reconnect even if its payload is unchanged.
+  virtual bool isMustAnnounce() const {
+    SIMPLEMQTT_CHECK_VALID(false);
+    return mustAnnounce;
+  };
+
+  // Sets whether publishes of this topic are skipped if the payload equals the last payload
+  // sent to the broker. Publishes that answer a request are always sent.
+  virtual MQTTTopic& setSuppressDuplicates(bool suppress) {
+    SIMPLEMQTT_CHECK_VALID(*this);
+    suppressDuplicates = suppress;
+    return *this;
+  };
+
+  virtual bool isSuppressDuplicates() const {
+    SIMPLEMQTT_CHECK_VALID(false);
+    return suppressDuplicates;
+  };
+
+  // Sets whether changes of the variable of this topic are detected by comparing its memory in bulk
+  // with the other watched variables instead of checking the topic individually.
+  // Applies to variable and reference topics of types that can be copied bytewise.
+  // Setting this on a group applies it to its subtopics.
+  virtual MQTTTopic& setWatched(bool aWatched) {
+    SIMPLEMQTT_CHECK_VALID(*this);
+    applyWatched(aWatched);
+    __internal::treeVersion++;
+    return *this;
+  };
+
+  virtual bool isWatched() const {
+    SIMPLEMQTT_CHECK_VALID(false);
+    return watched;
+  };
+
+  // Sets whether this topic keeps its formatted payload for publishing until the value is changed.
+  // Changes that SimpleMQTT does not notice, e. g. of array elements that are written directly,
+  // of JSON documents that are modified via references obtained earlier, or of the results
+  // of get functions, require a call of invalidatePayload().
+  virtual MQTTTopic& setPayloadCache(bool enable); // see MQTTImpl.h
+
+  // Sets the minimum time in milliseconds between two checks of this topic for changes of its value.
+  // For a group the interval applies to the group as a whole, i. e. its subtopics are only checked
+  // when the interval of the group has passed. 0 (the default) checks the topic on every pass.
+  // Changes of watched variables (see setWatched()) are detected regardless of the interval.
+  virtual MQTTTopic& setCheckInterval(uint32_t interval); // see MQTTImpl.h
+
+  uint32_t getCheckInterval() const {
+    SIMPLEMQTT_CHECK_VALID(0);
+    return (options == nullptr ? 0 : options->checkTimer.interval);
+  };
+
+  // Discards the cached payload so that it is formatted again when it is needed.
+  void invalidatePayload() {
+    if (options != nullptr)
+      options->payloadCache.valid = false;
+  };
+
+  // Returns the cached payload, formatting it if necessary, or nullptr if this topic does not cache its payload.
+  const String* getCachedPayload() {
+    SIMPLEMQTT_CHECK_VALID(nullptr);
+    __internal::PayloadCache* cache = payloadCache();
+    if (cache == nullptr)
+      return nullptr;
+    if (!cache->valid) {
+      cache->payload = getPayload();
+      cache->valid = true;
+    }
+    return &cache->payload;
   };
 
   // Returns whether this topic should be published to the broker
@@ -265,6 +497,15 @@ public:
   // using the current TopicOrder specified for the topic's group.
   virtual String getFullTopic(); // see MQTTImpl.h
 
+  // Returns a pointer to the cached full name of this topic.
+  // The pointer remains valid until the topic order or a pattern is changed.
+  const char* fullTopicStr() {
+    SIMPLEMQTT_CHECK_VALID(__internal::EMPTY);
+    if (cachedFullTopic == nullptr || cachedVersion != __internal::pathVersion)
+      updateTopicCache();
+    return cachedFullTopic;
+  };
+
   // Returns whether this topic has been changed since the last call to hasBeenChanged().
   // It makes no difference whether the topic has been changed via MQTT or by calling
   // the set() method or the assignment operator.
@@ -321,11 +562,64 @@ protected:
   MQTTFormattedTopic(MQTTGroup* a_parent, __internal::_Topic aTopic, uint8_t aConfig)
     : MQTTTopic(a_parent, aTopic, aConfig) {};
 
-  virtual bool _isEqual(T other) {
+  __internal::TopicOptions* allocateOptions() override {
+    return SIMPLEMQTT_ALLOCATE(__internal::FormattedTopicOptions<T>);
+  };
+
+  // Returns the settings including the state of the publish policy, nullptr if none have been made.
+  __internal::FormattedTopicOptions<T>* formattedOptions() const {
+    return static_cast<__internal::FormattedTopicOptions<T>*>(options);
+  };
+
+  virtual bool _isEqual(const T& other) {
     SIMPLEMQTT_CHECK_VALID(false);
     return value() == other;
   };
 
+  // Returns whether the new value is to be published according to the publish policy.
+  bool isPublishDue(const T& newValue) {
+    if constexpr (std::is_arithmetic_v<T>) {
+      const __internal::FormattedTopicOptions<T>* policy = formattedOptions();
+      if (policy == nullptr || policy->publishPolicy == PublishPolicy::ALWAYS)
+        return true;
+      T last = policy->publishedValue;
+      if constexpr (std::is_floating_point_v<T>) {
+        // NaN is published once; infinities are only equal to themselves
+        if (std::isnan(newValue) || std::isnan(last))
+          return std::isnan(newValue) != std::isnan(last);
+        if (std::isinf(newValue) || std::isinf(last))
+          return newValue != last;
+      }
+      double difference = fabs((double)newValue - (double)last);
+      switch (policy->publishPolicy) {
+        case PublishPolicy::ON_CHANGE:
+          return newValue != last;
+        case PublishPolicy::ABSOLUTE_DEADBAND:
+          return difference > policy->deadband;
+        case PublishPolicy::RELATIVE_DEADBAND:
+          return difference > fabs((double)last) * policy->deadband;
+        case PublishPolicy::FORMATTED: {
+          __internal::PayloadBuffer current;
+          __internal::PayloadBuffer published;
+          __internal::printValue(current, newValue, format);
+          __internal::printValue(published, last, format);
+          return !current.isComplete() || current.length() != published.length() || memcmp(current.data, published.data, current.length()) != 0;
+        }
+        default:
+          return true;
+      }
+    }
+    return true;
+  };
+
+  void payloadPublished() override {
+    if constexpr (std::is_arithmetic_v<T>) {
+      __internal::FormattedTopicOptions<T>* policy = formattedOptions();
+      if (policy != nullptr && policy->publishPolicy != PublishPolicy::ALWAYS)
+        policy->publishedValue = value();
+    }
+  };
+
 public:
   bool isSettable() const override {
     SIMPLEMQTT_CHECK_VALID(false);
@@ -345,6 +639,34 @@ public:
   virtual MQTTFormattedTopic<T>& setFormat(typename format_type<T>::type aFormat) {
     SIMPLEMQTT_CHECK_VALID(*this);
     format = aFormat;
+    invalidatePayload();
+    return *this;
+  };
+
+  // Returns the policy that determines which value changes are published automatically.
+  template<typename U = T, typename std::enable_if<std::is_arithmetic_v<U>, bool>::type* = nullptr> // only for arithmetic types
+  PublishPolicy getPublishPolicy() {
+    SIMPLEMQTT_CHECK_VALID(PublishPolicy::ALWAYS);
+    return (options == nullptr ? PublishPolicy::ALWAYS : formattedOptions()->publishPolicy);
+  };
+
+  // Sets the policy that determines which value changes are published automatically.
+  // The deadband applies to the policies ABSOLUTE_DEADBAND (in units of the value)
+  // and RELATIVE_DEADBAND (as a fraction of the last published value, e. g. 0.01 for 1 %).
+  // Values that are set via MQTT messages are always published.
+  template<typename U = T, typename std::enable_if<std::is_arithmetic_v<U>, bool>::type* = nullptr> // only for arithmetic types
+  MQTTFormattedTopic<T>& setPublishPolicy(PublishPolicy policy, float deadband = 0) {
+    SIMPLEMQTT_CHECK_VALID(*this);
+    if (policy == PublishPolicy::ALWAYS && options == nullptr)
+      return *this;
+    if (getOptions() == nullptr) {
+      SIMPLEMQTT_ERROR(PSTR("Not enough memory for publish policy, topic '%s'\n"), name());
+      return *this;
+    }
+    __internal::FormattedTopicOptions<T>* settings = formattedOptions();
+    settings->publishPolicy = policy;
+    settings->deadband = deadband;
+    settings->publishedValue = value();
     return *this;
   };
 
@@ -359,6 +681,11 @@ public:
     String s = __internal::formatValue(value(), format);
     return s;
   };
+
+  size_t printPayload(Print& p) const override {
+    SIMPLEMQTT_CHECK_VALID(0);
+    return __internal::printValue(p, value(), format);
+  };
 };
 
 // Co-variant return type setters for the specified type.
@@ -382,12 +709,46 @@ public:
   inline TYPE& setSettable(bool settable) override { \
     MQTTTopic::setSettable(settable); \
     return *this; \
+  }; \
+  inline TYPE& setPublishInterval(uint32_t minInterval, uint32_t maxInterval = 0) override { \
+    MQTTTopic::setPublishInterval(minInterval, maxInterval); \
+    return *this; \
+  }; \
+  inline TYPE& setBuffered(bool buffered) override { \
+    MQTTTopic::setBuffered(buffered); \
+    return *this; \
+  }; \
+  inline TYPE& setMustAnnounce(bool mustAnnounce) override { \
+    MQTTTopic::setMustAnnounce(mustAnnounce); \
+    return *this; \
+  }; \
+  inline TYPE& setSuppressDuplicates(bool suppress) override { \
+    MQTTTopic::setSuppressDuplicates(suppress); \
+    return *this; \
+  }; \
+  inline TYPE& setWatched(bool watched) override { \
+    MQTTTopic::setWatched(watched); \
+    return *this; \
+  }; \
+  inline TYPE& setPayloadCache(bool enable) override { \
+    MQTTTopic::setPayloadCache(enable); \
+    return *this; \
+  }; \
+  inline TYPE& setCheckInterval(uint32_t interval) override { \
+    MQTTTopic::setCheckInterval(interval); \
+    return *this; \
   };
 
-// Co-variant return type setFormat() function for the specified type.
+// Co-variant return type setFormat() and setPublishPolicy() functions for the specified type.
 #define SIMPLEMQTT_FORMAT_SETTER(TYPE, T) \
   inline TYPE& setFormat(typename format_type<T>::type aFormat) override { \
     SIMPLEMQTT_CHECK_VALID(*this); \
     MQTTFormattedTopic<T>::format = aFormat; \
+    MQTTTopic::invalidatePayload(); \
+    return *this; \
+  }; \
+  template<typename U = T, typename std::enable_if<std::is_arithmetic_v<U>, bool>::type* = nullptr> \
+  inline TYPE& setPublishPolicy(PublishPolicy policy, float deadband = 0) { \
+    MQTTFormattedTopic<T>::setPublishPolicy(policy, deadband); \
     return *this; \
   };
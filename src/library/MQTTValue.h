@@ -14,9 +14,7 @@ friend class SimpleMQTTClient;
 
 protected:
   typedef ResultCode (*PayloadHandler)(MQTTValue<T>& object, const char* payload);
-  PayloadHandler payloadHandler = [](MQTTValue<T>& object, const char* payload) {
-    return object.setFromPayload(payload);
-  };
+  PayloadHandler payloadHandler = nullptr;  // setFromPayload() is used if not set
   T _value{};
 
   MQTTValue(MQTTGroup* aParent, __internal::_Topic aTopic, uint8_t aConfig)
@@ -34,29 +32,74 @@ protected:
     return String("#"); 
   };
 
-  virtual void _setValue(T newValue) {
+  // Returns the variable that holds the value of this topic.
+  virtual T& _valueRef() {
+    return _value;
+  };
+
+  bool _isEqual(const T& other) override {
+    SIMPLEMQTT_CHECK_VALID(false);
+    return _valueRef() == other;
+  };
+
+  void _setValue(const T& newValue) {
+    SIMPLEMQTT_CHECK_VALID();
+    if constexpr (!std::is_const_v<T>)
+      _valueRef() = newValue;
+    MQTTTopic::invalidatePayload();
+  };
+
+  // Moves the new value into the variable so that its buffers are reused.
+  void _setValue(T&& newValue) {
     SIMPLEMQTT_CHECK_VALID();
     if constexpr (!std::is_const_v<T>)
-      _value = newValue;
+      _valueRef() = std::move(newValue);
+    MQTTTopic::invalidatePayload();
   };
 
-  virtual bool _set(T newValue) {
+  bool _set(const T& newValue) {
     SIMPLEMQTT_CHECK_VALID(false);
     if constexpr (std::is_const_v<T>)
       return false;
     bool changed = !this->_isEqual(newValue);
     _setValue(newValue);
+    if (MQTTTopic::isAutoPublish() && this->isPublishDue(newValue))
+      MQTTTopic::republish();
+    return changed;
+  };
+
+  bool _set(T&& newValue) {
+    SIMPLEMQTT_CHECK_VALID(false);
+    if constexpr (std::is_const_v<T>)
+      return false;
+    bool changed = !this->_isEqual(newValue);
+    bool publishDue = this->isPublishDue(newValue);
+    _setValue(std::move(newValue));
+    if (MQTTTopic::isAutoPublish() && publishDue)
+      MQTTTopic::republish();
+    return changed;
+  };
+
+  // Assigns the characters to a String value without creating a temporary String.
+  template<typename U = T, typename std::enable_if<std::is_same_v<U, String>, bool>::type* = nullptr>
+  bool _set(std::string_view newValue) {
+    SIMPLEMQTT_CHECK_VALID(false);
+    bool changed = !__internal::equalsPayload(_valueRef(), newValue);
+    if (changed) {
+      __internal::assignPayload(_valueRef(), newValue);
+      MQTTTopic::invalidatePayload();
+    }
     if (MQTTTopic::isAutoPublish())
       MQTTTopic::republish();
     return changed;
   };
 
-  ResultCode setReceived(const char* payload) override {
+  ResultCode setReceived(std::string_view payload) override {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
     if (MQTTTopic::isAutoPublish())
       MQTTTopic::republish();
     if (payloadHandler != nullptr)
-      return payloadHandler(*this, payload);
+      return payloadHandler(*this, __internal::payloadToString(payload).c_str());
     return setFromPayload(payload);
   };
 
@@ -81,14 +124,38 @@ public:
 	  return value();
   };
 
+  size_t printPayload(Print& p) const override {
+    SIMPLEMQTT_CHECK_VALID(0);
+    return __internal::printValue(p, _value, MQTTFormattedTopic<T>::format);
+  };
+
   // Sets the current value of this topic. Returns whether the value has changed.
   // Does not modify the Changed flag.
   template<typename U = T, typename std::enable_if<!std::is_const_v<U>, bool>::type* = nullptr> // only for non-const types
-  inline bool set(T newValue) {
+  inline bool set(const T& newValue) {
+    SIMPLEMQTT_CHECK_VALID(false);
+    return _set(newValue);
+  };
+
+  // Moves a temporary value into this topic. Returns whether the value has changed.
+  template<typename U = T, typename std::enable_if<!std::is_const_v<U>, bool>::type* = nullptr> // only for non-const types
+  inline bool set(T&& newValue) {
+    SIMPLEMQTT_CHECK_VALID(false);
+    return _set(std::move(newValue));
+  };
+
+  // Sets the value of a String topic from the specified characters, reusing the capacity of the current value.
+  template<typename U = T, typename std::enable_if<std::is_same_v<U, String>, bool>::type* = nullptr>
+  inline bool set(std::string_view newValue) {
     SIMPLEMQTT_CHECK_VALID(false);
     return _set(newValue);
   };
 
+  template<typename U = T, typename std::enable_if<std::is_same_v<U, String>, bool>::type* = nullptr>
+  inline bool set(const char* newValue) {
+    return set(std::string_view(newValue));
+  };
+
   template<typename U = T, typename std::enable_if<!std::is_const_v<U>, bool>::type* = nullptr> // only for non-const types
   inline MQTTValue<T>& operator=(const T& newValue) {
     SIMPLEMQTT_CHECK_VALID(*this);
@@ -96,17 +163,32 @@ public:
     return *this;
   };
 
+  template<typename U = T, typename std::enable_if<!std::is_const_v<U>, bool>::type* = nullptr> // only for non-const types
+  inline MQTTValue<T>& operator=(T&& newValue) {
+    SIMPLEMQTT_CHECK_VALID(*this);
+    _set(std::move(newValue));
+    return *this;
+  };
+
   // Sets the current value of this topic.
   // Checks whether the new value is different from the current value
   // and sets the Changed flag on the topic if this is the case.
   template<typename U = T, typename std::enable_if<!std::is_const_v<U>, bool>::type* = nullptr> // only for non-const types
-  inline MQTTValue<T>& setTo(T newValue) {
+  inline MQTTValue<T>& setTo(const T& newValue) {
     SIMPLEMQTT_CHECK_VALID(*this);
     bool changed = _set(newValue);
     MQTTTopic::setChanged(MQTTTopic::hasBeenChanged(false) || changed);
     return *this;
   };
 
+  template<typename U = T, typename std::enable_if<!std::is_const_v<U>, bool>::type* = nullptr> // only for non-const types
+  inline MQTTValue<T>& setTo(T&& newValue) {
+    SIMPLEMQTT_CHECK_VALID(*this);
+    bool changed = _set(std::move(newValue));
+    MQTTTopic::setChanged(MQTTTopic::hasBeenChanged(false) || changed);
+    return *this;
+  };
+
   // Sets the function that parses an incoming payload for this topic.
   template<typename U = T, typename std::enable_if<!std::is_const_v<U>, bool>::type* = nullptr> // only for non-const types
   MQTTValue<T>& setPayloadHandler(PayloadHandler handler) {
@@ -117,7 +199,7 @@ public:
 
   // Attempts to parse the payload and sets the newValue variable.
   // For use by custom implementations of payload handlers.
-  bool parseValue(const char* str, T* newValue) {
+  bool parseValue(std::string_view str, T* newValue) {
     if constexpr (std::is_const_v<T>)
       return false;
     return __internal::parseValue(str, newValue, MQTTFormattedTopic<T>::format);
@@ -125,11 +207,17 @@ public:
 
   // Attempts to set this topic's value from the supplied payload string.
   // Returns a ResultCode that indicates success or the reason of failure.
-  ResultCode setFromPayload(const char* payload) override {
+  ResultCode setFromPayload(std::string_view payload) override {
     SIMPLEMQTT_CHECK_VALID(ResultCode::OUT_OF_MEMORY);
     SIMPLEMQTT_DEBUG_SET_FROM_PAYLOAD;
     if constexpr (std::is_const_v<T>)
       return ResultCode::CANNOT_SET;
+    if constexpr (std::is_same_v<T, String>) {
+      // String values are assigned directly without a temporary copy
+      bool changed = _set(payload);
+      MQTTTopic::setChanged(MQTTTopic::hasBeenChanged(false) || changed);
+      return ResultCode::OK;
+    }
     T newValue = _value;
     if (!parseValue(payload, &newValue))
       return ResultCode::INVALID_PAYLOAD;
@@ -35,10 +35,13 @@ protected:
       MQTTValue<T>::_value = *newPtr;
   };
 
-  void _setValue(T newValue) override {
-    SIMPLEMQTT_CHECK_VALID();
-    if constexpr (!std::is_const_v<T>)
-      *valuePtr = newValue;
+  T& _valueRef() override {
+    return *valuePtr;
+  };
+
+  void addToWatchRegion(__internal::WatchRegion& region) override {
+    if constexpr (!std::is_const_v<T> && std::is_trivially_copyable_v<T>)
+      MQTTTopic::inWatchRegion = MQTTTopic::watched && MQTTTopic::isTopicValid() && region.add(this, valuePtr, sizeof(T));
   };
 
   bool check() override {
@@ -49,7 +52,8 @@ protected:
       // detect underlying value change
       if (!this->_isEqual(MQTTValue<T>::_value)) {
         MQTTValue<T>::_value = *valuePtr;
-        if (MQTTValue<T>::isAutoPublish())
+        MQTTTopic::invalidatePayload();
+        if (MQTTValue<T>::isAutoPublish() && this->isPublishDue(*valuePtr))
           MQTTValue<T>::republish();
       }
     }
@@ -69,6 +73,11 @@ public:
     return *valuePtr;
   };
 
+  size_t printPayload(Print& p) const override {
+    SIMPLEMQTT_CHECK_VALID(0);
+    return __internal::printValue(p, *valuePtr, MQTTValue<T>::format);
+  };
+
   // Sets the current value of this topic.
   // Checks whether the new value is different from the current value
   // and sets the Changed flag on the topic if this is the case.
@@ -0,0 +1,133 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT offline buffer for publishes during disconnects
+// Requires SIMPLEMQTT_OFFLINE_BUFFER to be greater than 0.
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+// Counters of the offline buffer.
+struct OfflineStatistics {
+  uint32_t stored = 0;   // publishes recorded in the buffer
+  uint32_t sent = 0;     // recorded publishes that have been sent after reconnect
+  uint32_t dropped = 0;  // publishes that have been lost because the buffer was full
+  uint32_t expired = 0;  // recorded publishes that have been discarded because they were too old
+};
+
+namespace __internal {
+
+  // Ring buffer of publishes that have been recorded while the client was disconnected.
+  // A record consists of a header followed by the payload; records may wrap around the end of the buffer.
+  // The buffer is a Print object that writes the payload of the record that has been started last.
+  class OfflineBuffer : public Print {
+  public:
+    struct Record {
+      MQTTTopic* topic;
+      uint32_t time;  // millis() when the record has been made
+      uint16_t length;
+    };
+
+    OfflineStatistics statistics;
+
+  protected:
+    uint8_t data[SIMPLEMQTT_OFFLINE_BUFFER];
+    size_t head = 0;  // start of the oldest record
+    size_t used = 0;
+    size_t tail = 0;  // write position of the payload of the current record
+    size_t remaining = 0;
+    uint16_t records = 0;
+
+    void copyIn(size_t pos, const void* src, size_t length) {
+      size_t first = (length < SIMPLEMQTT_OFFLINE_BUFFER - pos ? length : SIMPLEMQTT_OFFLINE_BUFFER - pos);
+      memcpy(&data[pos], src, first);
+      memcpy(&data[0], (const uint8_t*)src + first, length - first);
+    };
+
+    void copyOut(size_t pos, void* dst, size_t length) const {
+      size_t first = (length < SIMPLEMQTT_OFFLINE_BUFFER - pos ? length : SIMPLEMQTT_OFFLINE_BUFFER - pos);
+      memcpy(dst, &data[pos], first);
+      memcpy((uint8_t*)dst + first, &data[0], length - first);
+    };
+
+  public:
+    bool isEmpty() const {
+      return records == 0;
+    };
+
+    // Returns the number of recorded publishes.
+    uint16_t size() const {
+      return records;
+    };
+
+    // Returns the header of the oldest record. The buffer must not be empty.
+    Record peek() const {
+      Record record;
+      copyOut(head, &record, sizeof(Record));
+      return record;
+    };
+
+    // Writes the payload of the oldest record to the specified Print object.
+    void printPayload(Print& p, const Record& record) const {
+      size_t pos = (head + sizeof(Record)) % SIMPLEMQTT_OFFLINE_BUFFER;
+      size_t first = (record.length < SIMPLEMQTT_OFFLINE_BUFFER - pos ? record.length : SIMPLEMQTT_OFFLINE_BUFFER - pos);
+      p.write(&data[pos], first);
+      p.write(&data[0], record.length - first);
+    };
+
+    // Removes the oldest record.
+    void pop() {
+      if (records == 0)
+        return;
+      size_t size = sizeof(Record) + peek().length;
+      head = (head + size) % SIMPLEMQTT_OFFLINE_BUFFER;
+      used -= size;
+      records--;
+    };
+
+    // Starts a new record with a payload of the given length, making room according to the policy.
+    // Returns false if the publish has been dropped. Otherwise the payload must be written next.
+    bool begin(MQTTTopic* topic, size_t length, OfflinePolicy policy) {
+      size_t size = sizeof(Record) + length;
+      if (size > SIMPLEMQTT_OFFLINE_BUFFER || length > UINT16_MAX) {
+        statistics.dropped++;
+        return false;
+      }
+      while (SIMPLEMQTT_OFFLINE_BUFFER - used < size) {
+        if (policy == OfflinePolicy::DROP_NEWEST) {
+          statistics.dropped++;
+          return false;
+        }
+        pop();
+        statistics.dropped++;
+      }
+      Record record{ topic, (uint32_t)millis(), (uint16_t)length };
+      size_t pos = (head + used) % SIMPLEMQTT_OFFLINE_BUFFER;
+      copyIn(pos, &record, sizeof(Record));
+      tail = (pos + sizeof(Record)) % SIMPLEMQTT_OFFLINE_BUFFER;
+      remaining = length;
+      used += size;
+      records++;
+      statistics.stored++;
+      return true;
+    };
+
+    size_t write(uint8_t c) override {
+      if (remaining == 0)
+        return 0;
+      data[tail] = c;
+      tail = (tail + 1) % SIMPLEMQTT_OFFLINE_BUFFER;
+      remaining--;
+      return 1;
+    };
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+      if (size > remaining)
+        size = remaining;
+      copyIn(tail, buffer, size);
+      tail = (tail + size) % SIMPLEMQTT_OFFLINE_BUFFER;
+      remaining -= size;
+      return size;
+    };
+  };
+
+}  // namespace __internal
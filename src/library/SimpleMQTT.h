@@ -9,9 +9,16 @@
   #error This library requires a C++ standard of at least C++17!
 #endif
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <string_view>
 #include "PubSubClient.h"  // https://github.com/knolleary/pubsubclient
 
-#define SIMPLEMQTT_JSON_BUFFERSIZE    2048
+// Size of the Json document buffers. 0 disables Json support and the dependency on ArduinoJson.
+#ifndef SIMPLEMQTT_JSON_BUFFERSIZE
+  #define SIMPLEMQTT_JSON_BUFFERSIZE    2048
+#endif
 
 #if SIMPLEMQTT_JSON_BUFFERSIZE > 0
   #include <ArduinoJson.h>
@@ -30,11 +37,47 @@
   #define SIMPLEMQTT_MAX_TOPIC_LENGTH 32
 #endif
 
+// Number of topic strings copied from PROGMEM that are kept at the same time.
+#ifndef SIMPLEMQTT_PROGMEM_NAME_CACHE
+  #define SIMPLEMQTT_PROGMEM_NAME_CACHE 4
+#endif
+
+// Chunk size of the memory area that holds the cached full topic names.
+#ifndef SIMPLEMQTT_TOPIC_ARENA_CHUNK
+  #define SIMPLEMQTT_TOPIC_ARENA_CHUNK 256
+#endif
+
+// Maximum depth of the topic tree up to which the work of handle() can be split across several calls.
+// Deeper groups are processed as a whole.
+#ifndef SIMPLEMQTT_MAX_TREE_DEPTH
+  #define SIMPLEMQTT_MAX_TREE_DEPTH 6
+#endif
+
+// Number of slots (a power of two) and tick duration in milliseconds of the timer wheel for publish intervals.
+#ifndef SIMPLEMQTT_TIMER_SLOTS
+  #define SIMPLEMQTT_TIMER_SLOTS 16
+#endif
+#ifndef SIMPLEMQTT_TIMER_RESOLUTION
+  #define SIMPLEMQTT_TIMER_RESOLUTION 100
+#endif
+
 // Buffer size for conversion of values on the stack. Does not consume static memory.
 #ifndef SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER
   #define SIMPLEMQTT_FRACTIONAL_CONVERSION_BUFFER 100
 #endif
 
+// Buffer size on the stack for payloads that are being published.
+// The part of longer payloads that does not fit is kept in a String on the heap until the payload has been sent.
+#ifndef SIMPLEMQTT_PUBLISH_BUFFER
+  #define SIMPLEMQTT_PUBLISH_BUFFER 64
+#endif
+
+// Size in bytes of a RAM ring buffer that records publishes of buffered topics while the client is disconnected.
+// The recorded publishes are sent in order after the connection has been reestablished. 0 disables the buffer.
+#ifndef SIMPLEMQTT_OFFLINE_BUFFER
+  #define SIMPLEMQTT_OFFLINE_BUFFER 0
+#endif
+
 // #define SIMPLEMQTT_STATIC_MEMORY_SIZE  2048
 
 #if SIMPLEMQTT_STATIC_MEMORY_SIZE > 0 && SIMPLEMQTT_STATIC_MEMORY_SIZE < 64
@@ -44,6 +87,17 @@
   #error Static memory too large!
 #endif
 
+// Without static memory, objects of up to a quarter of this size are allocated from heap slabs of this size
+// in blocks of fixed size classes. This avoids the overhead and fragmentation of many small heap allocations.
+// 0 allocates each object on the heap individually.
+#ifndef SIMPLEMQTT_HEAP_SLAB_SIZE
+  #define SIMPLEMQTT_HEAP_SLAB_SIZE 512
+#endif
+
+#if SIMPLEMQTT_HEAP_SLAB_SIZE > 0 && SIMPLEMQTT_HEAP_SLAB_SIZE < 64
+  #error Please use heap slabs of at least 64 bytes!
+#endif
+
 #ifdef SIMPLEMQTT_DEBUG_SERIAL
   #ifndef SIMPLEMQTT_ERROR_SERIAL
     #define SIMPLEMQTT_ERROR_SERIAL SIMPLEMQTT_DEBUG_SERIAL
@@ -69,7 +123,7 @@
   #define SIMPLEMQTT_DEBUG_MEMORY false
 #endif
 
-#define SIMPLEMQTT_DEBUG_SET_FROM_PAYLOAD   SIMPLEMQTT_DEBUG(PSTR("%s.setFromPayload: %s\n"), MQTTTopic::getFullTopic().c_str(), payload);
+#define SIMPLEMQTT_DEBUG_SET_FROM_PAYLOAD   SIMPLEMQTT_DEBUG(PSTR("%s.setFromPayload: %.*s\n"), MQTTTopic::getFullTopic().c_str(), (int)payload.length(), payload.data());
 
 namespace SimpleMQTT {
 
@@ -119,6 +173,21 @@ namespace SimpleMQTT {
     BOTTOM_UP
   };
 
+  // Determines which value changes cause numeric topics to be published automatically.
+  enum class PublishPolicy : uint8_t {
+    ALWAYS,             // every time the value is set
+    ON_CHANGE,          // if the value differs from the last published value
+    ABSOLUTE_DEADBAND,  // if the value differs from the last published value by more than the deadband
+    RELATIVE_DEADBAND,  // if the value differs from the last published value by more than the deadband times its magnitude
+    FORMATTED           // if the formatted value differs from the last published payload
+  };
+
+  // Determines which publish is lost if the offline buffer is full.
+  enum class OfflinePolicy : uint8_t {
+    DROP_OLDEST,  // discard the oldest recorded publishes to make room
+    DROP_NEWEST   // discard the publish that does not fit
+  };
+
   static MQTTConfig DEFAULT_CONFIG = MQTTConfig::AUTO_PUBLISH + MQTTConfig::SETTABLE + MQTTConfig::REQUESTABLE;
   static TopicOrder DEFAULT_TOPIC_ORDER = TopicOrder::TOP_DOWN;
   static String DEFAULT_TOPIC_PATTERN("%s");
@@ -148,9 +217,20 @@ namespace SimpleMQTT {
 
   // forward class declarations
   class SimpleMQTTClient;
+  class MQTTTopic;
   class MQTTGroup;
   template <typename T> class MQTTArray;
 
+  #include "TopicIndex.h"
+
+  #include "TimerWheel.h"
+
+  #include "WatchRegion.h"
+
+#if SIMPLEMQTT_OFFLINE_BUFFER > 0
+  #include "OfflineBuffer.h"
+#endif
+
   #include "MQTTTopic.h"
 
   #include "MQTTValue.h"
@@ -0,0 +1,95 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT timer wheel for publish intervals
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+namespace __internal {
+
+  // Publish interval settings and scheduling state of a topic.
+  // In use for topics that have a minimum or maximum publish interval.
+  struct PublishTimer {
+    PublishTimer* next = nullptr;  // timers in the same wheel slot
+    PublishTimer* prev = nullptr;
+    MQTTTopic* topic = nullptr;
+    uint32_t minInterval = 0;  // milliseconds
+    uint32_t maxInterval = 0;  // milliseconds
+    uint32_t lastPublish = 0;  // millis() of the last publish
+    uint32_t due = 0;          // millis() at which the timer expires
+    uint8_t slot = 0;
+    bool scheduled = false;
+    bool published = false;    // lastPublish is valid
+    bool deferred = false;     // a publish waits for the minimum interval to pass
+  };
+
+  // Hashed timer wheel. Timers are stored in the slot of the tick (SIMPLEMQTT_TIMER_RESOLUTION milliseconds)
+  // at which they expire. Each tick only the timers of one slot are visited; timers that are due
+  // in a later revolution of the wheel stay in their slot.
+  class TimerWheel {
+    static const uint8_t MASK = SIMPLEMQTT_TIMER_SLOTS - 1;
+    static_assert((SIMPLEMQTT_TIMER_SLOTS & MASK) == 0 && SIMPLEMQTT_TIMER_SLOTS <= 256, "SIMPLEMQTT_TIMER_SLOTS must be a power of two up to 256!");
+
+    PublishTimer* slots[SIMPLEMQTT_TIMER_SLOTS] = {};
+    uint32_t processedTick = 0;
+    bool started = false;
+
+  public:
+    void schedule(PublishTimer* timer, uint32_t due) {
+      cancel(timer);
+      uint32_t tick = due / SIMPLEMQTT_TIMER_RESOLUTION + (due % SIMPLEMQTT_TIMER_RESOLUTION != 0 ? 1 : 0);
+      // ticks that have already been processed are visited again only after a full revolution
+      if ((int32_t)(tick - processedTick) <= 0)
+        tick = processedTick + 1;
+      timer->due = due;
+      timer->slot = tick & MASK;
+      timer->prev = nullptr;
+      timer->next = slots[timer->slot];
+      if (timer->next != nullptr)
+        timer->next->prev = timer;
+      slots[timer->slot] = timer;
+      timer->scheduled = true;
+    };
+
+    void cancel(PublishTimer* timer) {
+      if (!timer->scheduled)
+        return;
+      if (timer->prev != nullptr)
+        timer->prev->next = timer->next;
+      else
+        slots[timer->slot] = timer->next;
+      if (timer->next != nullptr)
+        timer->next->prev = timer->prev;
+      timer->next = nullptr;
+      timer->prev = nullptr;
+      timer->scheduled = false;
+    };
+
+    // Removes the timers that have expired at the given time.
+    // Returns them as a list that is linked by their next pointers.
+    PublishTimer* expire(uint32_t now) {
+      uint32_t nowTick = now / SIMPLEMQTT_TIMER_RESOLUTION;
+      uint32_t ticks = nowTick - processedTick;
+      if (!started || ticks > SIMPLEMQTT_TIMER_SLOTS) {
+        ticks = SIMPLEMQTT_TIMER_SLOTS;
+        started = true;
+      }
+      PublishTimer* result = nullptr;
+      for (uint32_t i = 0; i < ticks; i++) {
+        PublishTimer* timer = slots[(nowTick - i) & MASK];
+        while (timer != nullptr) {
+          PublishTimer* next = timer->next;
+          if ((int32_t)(now - timer->due) >= 0) {
+            cancel(timer);
+            timer->next = result;
+            result = timer;
+          }
+          timer = next;
+        }
+      }
+      processedTick = nowTick;
+      return result;
+    };
+  };
+
+}  // namespace __internal
@@ -0,0 +1,108 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT topic index for the dispatch of incoming messages
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+namespace __internal {
+
+  // Hash table that maps the request and set topics of a topic tree to their topic objects.
+  // Uses open addressing with linear probing. The final topic names are stored in an arena of
+  // the index so that a matching hash value can be confirmed without composing the names again.
+  // The index is built in two passes: the first pass counts the entries, the second one fills the table.
+  class TopicIndex {
+  public:
+    enum Kind : uint8_t {
+      REQUEST,
+      SET,
+      SET_DIRECT  // top-level topic that is set via its own topic
+    };
+
+    struct Entry {
+      uint32_t hash;
+      MQTTTopic* topic;
+      Kind kind;
+      const char* name;  // final topic name, stored in the names arena
+    };
+
+  protected:
+    Entry* entries = nullptr;
+    size_t capacity = 0;  // always a power of two
+    size_t count = 0;
+    uint16_t version = 0;
+    StringArena names;
+
+  public:
+    ~TopicIndex() {
+      clear();
+    };
+
+    // Releases the table and starts a new counting pass.
+    void clear() {
+      if (entries != nullptr)
+        SIMPLEMQTT_DEALLOCATE_MEM(entries, capacity * sizeof(Entry));
+      entries = nullptr;
+      capacity = 0;
+      count = 0;
+      names.reset();
+    };
+
+    // Allocates the table for the number of entries counted so far and starts the fill pass.
+    bool allocate() {
+      size_t required = count + count / 2;
+      capacity = 8;
+      while (capacity < required)
+        capacity <<= 1;
+      entries = SIMPLEMQTT_ALLOCATE_MEM(Entry, capacity * sizeof(Entry));
+      if (entries == nullptr) {
+        capacity = 0;
+        return false;
+      }
+      memset((void*)entries, 0, capacity * sizeof(Entry));
+      count = 0;
+      version = treeVersion;
+      return true;
+    };
+
+    // Returns whether the table reflects the current state of the topic tree.
+    bool isCurrent() const {
+      return entries != nullptr && version == treeVersion;
+    };
+
+    // Adds the given final topic name. If the name cannot be stored the index is cleared.
+    void add(MQTTTopic* topic, Kind kind, const String& name) {
+      if (entries == nullptr) {
+        count++;
+        return;
+      }
+      const char* stored = names.add(name.c_str(), name.length());
+      if (stored == nullptr) {
+        clear();
+        return;
+      }
+      uint32_t hash = hashString(stored);
+      size_t mask = capacity - 1;
+      size_t i = hash & mask;
+      // entries with equal keys stay in insertion order which preserves the tree order on lookup
+      while (entries[i].topic != nullptr)
+        i = (i + 1) & mask;
+      entries[i] = Entry{ hash, topic, kind, stored };
+      count++;
+    };
+
+    // Returns the first entry for the given final topic name.
+    const Entry* find(const char* topic) const {
+      if (entries == nullptr)
+        return nullptr;
+      uint32_t hash = hashString(topic);
+      size_t mask = capacity - 1;
+      for (size_t i = hash & mask; entries[i].topic != nullptr; i = (i + 1) & mask) {
+        if (entries[i].hash == hash && strcmp(entries[i].name, topic) == 0)
+          return &entries[i];
+      }
+      return nullptr;
+    };
+  };
+
+}  // namespace __internal
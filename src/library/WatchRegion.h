@@ -0,0 +1,180 @@
+/////////////////////////////////////////////////////////////////////
+// SimpleMQTT watch region for bulk change detection of variables
+// Copyright (c) Leo Meyer, leo@leomeyer.de
+// Licensed under the MIT license.
+// https://github.com/leomeyer/SimpleMQTT
+/////////////////////////////////////////////////////////////////////
+
+namespace __internal {
+
+  // Snapshot of the memory of watched variables that is compared in bulk to find the variables that have changed.
+  // The variables are sorted by address and combined into runs of adjacent memory. Each run is compared with
+  // a single memcmp(); only the variables of runs that differ are compared individually.
+  // The region is built in two passes: the first pass counts the variables, the second one stores them.
+  class WatchRegion {
+  public:
+    struct Entry {
+      MQTTTopic* topic;
+      const uint8_t* address;
+      uint16_t size;
+    };
+
+    struct Run {
+      const uint8_t* address;
+      size_t size;
+      size_t offset;   // position of the copy in the snapshot
+      uint16_t first;  // index of the first entry
+      uint16_t count;
+    };
+
+  protected:
+    // variables that are at most this many bytes apart (i. e. alignment padding) are combined into one run
+    static const size_t MAX_GAP = 8;
+
+    Entry* entries = nullptr;
+    Run* runs = nullptr;
+    uint8_t* snapshot = nullptr;
+    uint16_t count = 0;
+    uint16_t capacity = 0;
+    uint16_t runCount = 0;
+    size_t snapshotSize = 0;
+    uint16_t version = 0;
+    bool current = false;
+    bool filling = false;
+    bool initialized = false;  // the snapshot has been taken
+
+    // Combines the sorted entries into runs and sums up their sizes.
+    // Only counts the runs if they have not been allocated yet.
+    void makeRuns() {
+      runCount = 0;
+      snapshotSize = 0;
+      const uint8_t* start = nullptr;
+      const uint8_t* end = nullptr;
+      uint16_t first = 0;
+      for (uint16_t i = 0; i <= count; i++) {
+        if (i > 0 && i < count && entries[i].address <= end + MAX_GAP) {
+          // extend the current run
+          if (entries[i].address + entries[i].size > end)
+            end = entries[i].address + entries[i].size;
+          continue;
+        }
+        if (i > 0) {
+          if (runs != nullptr)
+            runs[runCount] = Run{ start, (size_t)(end - start), snapshotSize, first, (uint16_t)(i - first) };
+          runCount++;
+          snapshotSize += end - start;
+        }
+        if (i < count) {
+          start = entries[i].address;
+          end = start + entries[i].size;
+          first = i;
+        }
+      }
+    };
+
+  public:
+    ~WatchRegion() {
+      clear();
+    };
+
+    // Releases the region and starts a new counting pass.
+    void clear() {
+      if (entries != nullptr)
+        SIMPLEMQTT_DEALLOCATE_MEM(entries, capacity * sizeof(Entry));
+      if (runs != nullptr)
+        SIMPLEMQTT_DEALLOCATE_MEM(runs, runCount * sizeof(Run));
+      if (snapshot != nullptr)
+        SIMPLEMQTT_DEALLOCATE_MEM(snapshot, snapshotSize);
+      entries = nullptr;
+      runs = nullptr;
+      snapshot = nullptr;
+      count = 0;
+      capacity = 0;
+      runCount = 0;
+      snapshotSize = 0;
+      current = false;
+      filling = false;
+      initialized = false;
+    };
+
+    // Allocates the entries counted so far and starts the pass that stores them.
+    bool allocate() {
+      capacity = count;
+      count = 0;
+      if (capacity > 0) {
+        entries = SIMPLEMQTT_ALLOCATE_MEM(Entry, capacity * sizeof(Entry));
+        if (entries == nullptr) {
+          capacity = 0;
+          return false;
+        }
+      }
+      filling = true;
+      return true;
+    };
+
+    // Counts or stores a variable. Returns whether the variable is part of the region.
+    bool add(MQTTTopic* topic, const void* address, size_t size) {
+      if (!filling) {
+        count++;
+        return false;
+      }
+      if (count >= capacity)
+        return false;
+      entries[count++] = Entry{ topic, (const uint8_t*)address, (uint16_t)size };
+      return true;
+    };
+
+    // Sorts the stored variables by address and combines them into runs.
+    bool finish() {
+      filling = false;
+      std::sort(entries, entries + count, [](const Entry& a, const Entry& b) { return a.address < b.address; });
+      makeRuns();
+      if (runCount == 0)
+        return true;
+      runs = SIMPLEMQTT_ALLOCATE_MEM(Run, runCount * sizeof(Run));
+      snapshot = SIMPLEMQTT_ALLOCATE_MEM(uint8_t, snapshotSize);
+      if (runs == nullptr || snapshot == nullptr)
+        return false;
+      makeRuns();
+      return true;
+    };
+
+    // Marks the region as reflecting the current state of the topic tree.
+    void setCurrent() {
+      version = treeVersion;
+      current = true;
+    };
+
+    // Returns whether the region reflects the current state of the topic tree.
+    bool isCurrent() const {
+      return current && version == treeVersion;
+    };
+
+    // Returns the number of watched variables.
+    uint16_t size() const {
+      return (runs != nullptr ? count : 0);
+    };
+
+    // Calls the changed function for each topic whose variable differs from the snapshot and updates the snapshot.
+    // The first call after building the region reports all topics.
+    template<typename F>
+    void compare(F changed) {
+      if (runs == nullptr)
+        return;
+      for (uint16_t r = 0; r < runCount; r++) {
+        const Run& run = runs[r];
+        uint8_t* copy = &snapshot[run.offset];
+        if (initialized && memcmp(run.address, copy, run.size) == 0)
+          continue;
+        for (uint16_t i = run.first; i < run.first + run.count; i++) {
+          const Entry& e = entries[i];
+          if (!initialized || memcmp(e.address, copy + (e.address - run.address), e.size) != 0)
+            changed(e.topic);
+        }
+        memcpy(copy, run.address, run.size);
+      }
+      initialized = true;
+    };
+  };
+
+}  // namespace __internal